@@ -20,258 +20,1814 @@
  #include <pgmspace.h>
 #else
  #define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+ #define pgm_read_word(addr) (*(const unsigned short *)(addr))
+#endif
+#ifndef PROGMEM
+ #define PROGMEM
 #endif
 
-#if !defined(__ARM_ARCH) && !defined(ENERGIA) && !defined(ESP8266) && !defined(ESP32) && !defined(__arc__)
+#if !defined(__ARM_ARCH) && !defined(ENERGIA) && !defined(ESP8266) && !defined(ESP32) && !defined(__arc__) && \
+    !defined(INA_HOST_BUILD)
  #include <util/delay.h>
 #endif
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "DBOE_INA226.h"                                                       // Include the header definition
-#include <Wire.h>                                                              // I2C Library definition
-INA226_Class::INA226_Class()  {}                                               // Class constructor
-INA226_Class::~INA226_Class() {}                                               // Unused class destructor
+
+#define INA_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")           // No memory access moves across
+
+const uint16_t inaConversionMicros[8] PROGMEM = {140,204,332,588,1100,2116,4156,8244};// Datasheet times
+const uint16_t inaAverages[8]         PROGMEM = {1,4,16,64,128,256,512,1024};  // Averages per code
+
+/*******************************************************************************************************************
+** Functions inaWireWrite and inaWireRead send and fetch one byte through the unit's transport                    **
+*******************************************************************************************************************/
+static inline void inaWireWrite(INA_TRANSPORT *wire,uint8_t data) {wire->write(data);}
+static inline uint8_t inaWireRead(INA_TRANSPORT *wire) {return((uint8_t)wire->read());}
+
+/*******************************************************************************************************************
+** Function inaCurrentRaw applies the INA226 current equation Current = Shunt*Cal/2048 (datasheet equation 3) and **
+** limits the result to the range of the 16 bit current register                                                  **
+*******************************************************************************************************************/
+static inline int16_t inaCurrentRaw(int16_t shuntRaw,int32_t calibration) {
+  int32_t currentRaw = (int32_t)shuntRaw*calibration/2048;                     // Current = Shunt*Cal/2048
+  if (currentRaw> 32767) currentRaw =  32767;                                  // Limit to register range
+  if (currentRaw<-32768) currentRaw = -32768;
+  return((int16_t)currentRaw);
+} // END of function inaCurrentRaw()
+
+/*******************************************************************************************************************
+** Function inaPowerRaw applies the INA226 power equation Power = Current*Bus/20000 (datasheet equation 4) and    **
+** limits the result to the range of the 16 bit power register                                                    **
+*******************************************************************************************************************/
+static inline uint16_t inaPowerRaw(int16_t currentRaw,uint16_t busRaw) {
+  uint32_t powerRaw = (uint32_t)(currentRaw<0 ? -(int32_t)currentRaw : currentRaw)*busRaw/20000;
+  if (powerRaw>65535) powerRaw = 65535;                                        // Limit to register range
+  return((uint16_t)powerRaw);
+} // END of function inaPowerRaw()
+
+/*******************************************************************************************************************
+** Function inaScale converts a raw current value, or 25 times a raw power value, to micro units. The LSB in      **
+** micro units is held as whole and fixedPoint() fraction, so there are only 32 bit multipliers and the widest    **
+** product is 32x32->64 bits. The magnitude is scaled so negative values are truncated toward zero like an        **
+** integer division.                                                                                              **
+*******************************************************************************************************************/
+static inline int32_t inaScale(int32_t raw,uint32_t whole,uint32_t fraction) {
+  uint32_t magnitude = raw<0 ? -raw : raw;                                     // Scale the magnitude
+  uint32_t value     = magnitude*whole+(uint32_t)((uint64_t)magnitude*fraction>>INA_FIXED_POINT_SHIFT);
+  return(raw<0 ? -(int32_t)value : (int32_t)value);                            // Put the sign back
+} // END of function inaScale()
+
+INA226_Core::INA226_Core(inaSTRUCT *units,uint8_t unitCount) :                 // Class constructor
+  inaARRAY(units), _unitCount(unitCount) {                                     // Storage comes from INA226_Bank
+  memset(inaARRAY,0,sizeof(inaSTRUCT)*(_unitCount+1));                         // Mark all units as unused
+  _buses[0].wire = &INA_TRANSPORT_DEFAULT;                                     // Bus 0 is always the default
+} // END of constructor
+INA226_Core::~INA226_Core() {}                                                 // Unused class destructor
 
 /*******************************************************************************************************************
 ** Method begin() sets the INA226 Configuration details, If no details a single device (ebay special) is assumed  **
 *******************************************************************************************************************/
-void INA226_Class::begin(uint32_t MAXmilliAmps,                                 // Max expected milliamps
+void INA226_Core::begin(uint32_t MAXmilliAmps,                                 // Max expected milliamps
                          uint32_t SenseRes,                                    // Sense Resistor in microOhms
                          uint8_t UNIT_ID,                                      // INA226 Unit number
-                         uint8_t I2C_ADDR) {                                   // INA226 I2C Address
-  Wire.begin();                                                                // Start the I2C wire subsystem
-  Wire.beginTransmission(I2C_ADDR);                                            // See if something is at address
-  if (Wire.endTransmission() == 0) {                                           // by checking the return error
-    inaWriteWord(INA_CONFIG_REG,INA_RESET_DEVICE,I2C_ADDR);                    // Force INAs to reset
+                         uint8_t I2C_ADDR,                                     // INA226 I2C Address
+                         uint8_t BUS_ID) {                                     // Bus from addBus()
+  if (UNIT_ID>=_unitCount || BUS_ID>=_busCount) return;                        // No room or no such bus
+  startWire(BUS_ID);                                                           // Start the I2C wire subsystem
+  inaSTRUCT &candidate = inaCandidate(I2C_ADDR,BUS_ID);                        // Not in the table yet
+  if (inaProbe(candidate) && inaIdentify(candidate)) {                         // An INA226 is at the address
+    inaWriteWord(INA_CONFIG_REG,INA_RESET_DEVICE,candidate);                   // Force it to reset
     delayMicroseconds(I2C_RESET_DELAY);                                        // Wait for INA to finish resetting
-    if (inaReadWord(INA_CONFIG_REG,I2C_ADDR)==INA_DEFAULT_CONFIG) {            // Yes, we've found a INA226!
-      inaARRAY[UNIT_ID].address = I2C_ADDR;                                    // Store device address
-      inaARRAY[UNIT_ID].current_LSB = (uint32_t)MAXmilliAmps*1000000/32768;    // Calc current_LSB register
-      inaARRAY[UNIT_ID].calibration = (uint32_t)51200000 /                     // Calc calibration register
-      (((uint32_t)inaARRAY[UNIT_ID].current_LSB * (uint32_t)SenseRes) / (uint64_t)100000);
-      inaARRAY[UNIT_ID].power_LSB = (uint32_t)25*inaARRAY[UNIT_ID].current_LSB;// Fixed multiplier for INA226
-      inaARRAY[UNIT_ID].operatingMode = B111;                                  // Default to continuous mode
-      inaWriteWord(INA_CALIBRATION_REG,inaARRAY[UNIT_ID].calibration,          // Write the calibration value
-                inaARRAY[UNIT_ID].address);                                    // INA226 I2C Address
-    }
+    if (inaReadWord(INA_CONFIG_REG,candidate)==INA_DEFAULT_CONFIG)             // Yes, we've found a INA226!
+      initUnit(UNIT_ID,I2C_ADDR,BUS_ID,MAXmilliAmps,SenseRes);                 // Store and calibrate it
   }
+  candidate.address = 0;                                                       // Spare entry is unused again
 } // END of method begin()
 
+/*******************************************************************************************************************
+** Method scan probes every address an INA226 can use (INA_SCAN_FIRST to INA_SCAN_LAST) on one bus in a single    **
+** pass. A device that answers is only reset once its ID registers show it is an INA226, other chips sharing the  **
+** address range are left alone, and probing stops when every free unit has been given a device. One reset delay  **
+** covers all of them, then each one whose configuration register reads back as INA_DEFAULT_CONFIG is stored in   **
+** the next free unit and calibrated with the given values. Units previously found on the same bus are released   **
+** first, units on other buses are kept, so each bus can be scanned in turn. Returns the number of INA226 devices **
+** found on the bus.                                                                                              **
+*******************************************************************************************************************/
+uint8_t INA226_Core::scan(uint32_t MAXmilliAmps,                               // Max expected milliamps
+                          uint32_t SenseRes,                                   // Sense Resistor in microOhms
+                          uint8_t BUS_ID) {                                    // Bus from addBus()
+  uint16_t responders = 0;                                                     // Bit per INA226 that was reset
+  uint8_t  found      = 0;                                                     // Number of INA226s stored
+  uint8_t  unit       = 0;                                                     // Next unit to look at
+  uint8_t  slots      = 0;                                                     // Free units to fill
+  if (BUS_ID>=_busCount) return(0);                                            // No such bus
+  startWire(BUS_ID);                                                           // Start the I2C wire subsystem
+  for (unit=0;unit<_unitCount;unit++) {                                        // Forget this bus's old units
+    if (inaARRAY[unit].bus==BUS_ID) inaARRAY[unit].address = 0;
+    if (inaARRAY[unit].address==0) slots++;                                    // and count the free ones
+  }
+  for (uint8_t i=0;i<=INA_SCAN_LAST-INA_SCAN_FIRST && slots;i++) {             // First pass, identify and reset
+    inaSTRUCT &candidate = inaCandidate(INA_SCAN_FIRST+i,BUS_ID);              // Not in the table yet
+    if (inaProbe(candidate) && inaIdentify(candidate)) {                       // An INA226 answered
+      inaWriteWord(INA_CONFIG_REG,INA_RESET_DEVICE,candidate);                 // Force it to reset
+      responders |= (uint16_t)1<<i;                                            // Remember it for the 2nd pass
+      slots--;                                                                 // It has a unit to go to
+    }
+  }
+  if (responders) delayMicroseconds(I2C_RESET_DELAY);                          // One wait covers every reset
+  unit = 0;
+  for (uint8_t i=0;i<=INA_SCAN_LAST-INA_SCAN_FIRST;i++) {                      // Second pass, store devices
+    if (!bitRead(responders,i)) continue;                                      // No INA226 at this address
+    while (unit<_unitCount && inaARRAY[unit].address!=0) unit++;               // Next free unit
+    if (inaReadWord(INA_CONFIG_REG,inaCandidate(INA_SCAN_FIRST+i,BUS_ID))==INA_DEFAULT_CONFIG) {
+      initUnit(unit,INA_SCAN_FIRST+i,BUS_ID,MAXmilliAmps,SenseRes);            // Yes, we've found a INA226!
+      found++;
+    }
+  }
+  inaARRAY[_unitCount].address = 0;                                            // Spare entry is unused again
+  return(found);                                                               // return number of devices
+} // END of method scan()
+
+/*******************************************************************************************************************
+** Method initUnit stores a freshly reset INA226 in the table, computes its LSB values and writes calibration     **
+*******************************************************************************************************************/
+void INA226_Core::initUnit(uint8_t UNIT_ID,uint8_t I2C_ADDR,uint8_t BUS_ID,uint32_t MAXmilliAmps,
+                           uint32_t SenseRes) {
+  memset(&inaARRAY[UNIT_ID],0,sizeof(inaSTRUCT));                              // Start from a clean entry
+  inaACCUMULATOR *acc = inaAccumulator(UNIT_ID);                               // and clean accumulators
+  if (acc) memset(acc,0,sizeof(inaACCUMULATOR));
+  clearTripState(UNIT_ID);                                                     // and no relay until setTrip()
+  inaBUSHEALTH *health = inaHealth(inaARRAY[UNIT_ID]);                         // Fresh I2C error counters
+  if (health) memset(health,0,sizeof(inaBUSHEALTH));
+  inaARRAY[UNIT_ID].address = I2C_ADDR;                                        // Store device address
+  inaARRAY[UNIT_ID].bus = BUS_ID;                                              // and the bus it is on
+  uint32_t current_LSB = (uint64_t)MAXmilliAmps*1000000/32768;                 // Calc current_LSB register
+  inaARRAY[UNIT_ID].calibration = (uint32_t)51200000 /                         // Calc calibration register
+  (((uint32_t)current_LSB * (uint32_t)SenseRes) / (uint64_t)100000);
+  inaARRAY[UNIT_ID].lsbWhole    = current_LSB/1000;                            // Store it in uA as whole and
+  inaARRAY[UNIT_ID].lsbFraction = fixedPoint(current_LSB);                     // fraction, power_LSB is 25 times
+  inaARRAY[UNIT_ID].microOhms = SenseRes;                                      // Shunt resistor value
+  inaARRAY[UNIT_ID].configRegister = INA_DEFAULT_CONFIG;                       // Shadow the reset values
+  inaARRAY[UNIT_ID].maskRegister = 0;
+  inaARRAY[UNIT_ID].conversionStart = micros();                                // Reset started a conversion
+  inaWriteWord(INA_CALIBRATION_REG,inaARRAY[UNIT_ID].calibration,              // Write the calibration value
+               inaARRAY[UNIT_ID]);                                             // to the INA226
+} // END of method initUnit()
+
+/*******************************************************************************************************************
+** Method startWire starts the I2C wire subsystem of a bus the first time it is called and applies the clock set  **
+** with setClock()                                                                                                **
+*******************************************************************************************************************/
+void INA226_Core::startWire(uint8_t BUS_ID) {
+  inaBUS &bus = _buses[BUS_ID];                                                // Bus table entry
+  if (bus.started) return;                                                     // Only needs doing once
+  bus.wire->begin();                                                           // Start the I2C wire subsystem
+  if (bus.clock) bus.wire->setClock(bus.clock);                                // Requested speed, if any
+  bus.started = true;
+} // END of method startWire()
+
+/*******************************************************************************************************************
+** Method inaUnit returns the table entry for UNIT_ID. Out of range values return the spare entry at the end of   **
+** the table, which never has an address so no I2C traffic is generated for it                                    **
+*******************************************************************************************************************/
+inaSTRUCT& INA226_Core::inaUnit(uint8_t UNIT_ID) {
+  return(inaARRAY[UNIT_ID<_unitCount ? UNIT_ID : _unitCount]);                 // Bounds checked entry
+} // END of method inaUnit()
+
+/*******************************************************************************************************************
+** Method inaAccumulator returns the accumulators of UNIT_ID from the set given to setAccumulators(), or NULL if  **
+** no set was given or it has no entry for the unit                                                               **
+*******************************************************************************************************************/
+inaACCUMULATOR* INA226_Core::inaAccumulator(uint8_t UNIT_ID) {
+  if (_accumulators==NULL || UNIT_ID>=_unitCount) return(NULL);                // No storage for this unit
+  return(_accumulators->unit(UNIT_ID));                                        // return entry or NULL
+} // END of method inaAccumulator()
+
+/*******************************************************************************************************************
+** Method inaTrip returns the trip state of UNIT_ID from the set given to setTrips(), or NULL if no set was given **
+** or it has no entry for the unit                                                                                **
+*******************************************************************************************************************/
+inaTRIP* INA226_Core::inaTrip(uint8_t UNIT_ID) {
+  if (_trips==NULL || UNIT_ID>=_unitCount) return(NULL);                       // No storage for this unit
+  return(_trips->unit(UNIT_ID));                                               // return entry or NULL
+} // END of method inaTrip()
+
+/*******************************************************************************************************************
+** Method getUnitCount returns the number of units the table was sized for                                        **
+*******************************************************************************************************************/
+uint8_t INA226_Core::getUnitCount() {
+  return(_unitCount);                                                          // return table size
+} // END of method getUnitCount()
+
+/*******************************************************************************************************************
+** Method addBus registers another I2C bus, e.g. Wire1, and returns the BUS_ID to pass to begin() and scan(). A   **
+** bus already registered returns its existing BUS_ID, INA_NO_BUS is returned when INA_MAX_BUSES are in use       **
+*******************************************************************************************************************/
+uint8_t INA226_Core::addBus(INA_TRANSPORT &wire) {
+  for (uint8_t i=0;i<_busCount;i++) if (_buses[i].wire==&wire) return(i);      // Already known
+  if (_busCount>=INA_MAX_BUSES) return(INA_NO_BUS);                            // No room in the table
+  memset(&_buses[_busCount],0,sizeof(inaBUS));                                 // Fresh entry
+  _buses[_busCount].wire = &wire;
+  return(_busCount++);                                                         // return new BUS_ID
+} // END of method addBus()
+
+/*******************************************************************************************************************
+** Methods getBusCount and getBus return the number of registered buses and the BUS_ID a unit is on               **
+*******************************************************************************************************************/
+uint8_t INA226_Core::getBusCount() {
+  return(_busCount);                                                           // return buses registered
+} // END of method getBusCount()
+
+uint8_t INA226_Core::getBus(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).bus);                                                // return BUS_ID
+} // END of method getBus()
+
+/*******************************************************************************************************************
+** Method setClock sets the SCL frequency of a bus, limited to the 400kHz of I2C fast mode. Each bus keeps its    **
+** own speed so a long or heavily loaded bus can run slower without holding the others back. Faster speeds need   **
+** setHighSpeed(). The clock is applied now if the bus is running, otherwise when it is started.                  **
+*******************************************************************************************************************/
+void INA226_Core::setClock(uint32_t clock,uint8_t BUS_ID) {
+  if (BUS_ID>=_busCount) return;                                               // No such bus
+  inaBUS &bus = _buses[BUS_ID];                                                // Bus table entry
+  bus.clock = clock>INA_I2C_FAST_CLOCK ? INA_I2C_FAST_CLOCK : clock;           // Fast mode is the limit
+  if (bus.started && bus.clock) bus.wire->setClock(bus.clock);                 // Apply straight away
+} // END of method setClock()
+
+/*******************************************************************************************************************
+** Method setHighSpeed turns on the INA226 high-speed mode for a bus, up to 2.94MHz, or turns it off with 0. Each **
+** transfer is then preceded by the HS master code at the normal clock and runs at the HS clock until its STOP.   **
+** The transport must support the requested clock and repeated STARTs, and every device on the bus must be able   **
+** to cope with HS mode traffic. Returns false, leaving the bus at its normal clock, if the transport was not     **
+** declared HS capable with INA_TRANSPORT_HIGH_SPEED (see DBOE_INA226.h) or there is no such bus.                 **
+*******************************************************************************************************************/
+bool INA226_Core::setHighSpeed(uint32_t clock,uint8_t BUS_ID) {
+  if (BUS_ID>=_busCount) return(false);                                        // No such bus
+#if INA_TRANSPORT_HIGH_SPEED
+  _buses[BUS_ID].highSpeedClock = clock>INA_I2C_HS_CLOCK ? INA_I2C_HS_CLOCK : clock;// Device limit
+  return(true);
+#else
+  return(clock==0);                                                            // Only "off" is possible
+#endif
+} // END of method setHighSpeed()
+
+/*******************************************************************************************************************
+** Function inaCount increments an error counter, stopping at the largest value rather than wrapping round        **
+*******************************************************************************************************************/
+static inline void inaCount(uint16_t &counter) {
+  if (counter<0xFFFF) counter++;                                               // Saturate, don't wrap
+} // END of function inaCount()
+
+/*******************************************************************************************************************
+** Method inaCandidate points the spare entry at a device which is not in the table yet, so begin() and scan()    **
+** can use the same primitives as every other method. Their traffic is charged to the bus health counters for     **
+** addresses not in the table. The caller sets the address back to 0 when done so out of range UNIT_IDs stay off  **
+** the bus.                                                                                                       **
+*******************************************************************************************************************/
+inaSTRUCT& INA226_Core::inaCandidate(uint8_t I2C_ADDR,uint8_t BUS_ID) {
+  inaARRAY[_unitCount].address = I2C_ADDR;                                     // Device to talk to
+  inaARRAY[_unitCount].bus     = BUS_ID;                                       // and the bus it is on
+  return(inaARRAY[_unitCount]);                                                // return the spare entry
+} // END of method inaCandidate()
+
+/*******************************************************************************************************************
+** Method inaProbe checks whether a device acknowledges the given address. A probe is expected to fail when no    **
+** device is present, so it is never retried and does not count towards the bus health counters                   **
+*******************************************************************************************************************/
+bool INA226_Core::inaProbe(inaSTRUCT &unit) {
+  INA_TRANSPORT *wire = _buses[unit.bus].wire;                                 // Bus the device is on
+  uint32_t start = micros();                                                   // Time the transfer
+  wire->beginTransmission(unit.address);                                       // See if something is at address
+  _TransmissionStatus = wire->endTransmission();                               // by checking the return error
+  _transactionCount++;                                                         // Single address-only transaction
+  _byteCount++;                                                                // Address byte only
+  recordLatency(INA_LATENCY_PROBE,micros()-start);                             // Add to the histogram
+  return(_TransmissionStatus==0);                                              // true if acknowledged
+} // END of method inaProbe()
+
+/*******************************************************************************************************************
+** Method inaIdentify reads the manufacturer and die ID registers, so only an INA226 is ever sent a reset. Other  **
+** devices in the same address range, including other INA2xx parts, return different values                       **
+*******************************************************************************************************************/
+bool INA226_Core::inaIdentify(inaSTRUCT &unit) {
+  return((uint16_t)inaReadWord(INA_MANUFACTURER_ID_REG,unit)==INA_MANUFACTURER_ID &&
+         (uint16_t)inaReadWord(INA_DIE_ID_REG,unit)==INA_DIE_ID);              // true if both match
+} // END of method inaIdentify()
+
+/*******************************************************************************************************************
+** Method inaRead sets the register pointer and reads "length" bytes back. A NACK, transport error or short read  **
+** is counted against the unit and the whole transfer is repeated up to _retries times, waiting _backoff          **
+** microseconds before the first retry and twice as long before each following one. Returns false and zeroes      **
+** the data if every attempt failed, so a failed read can never be mistaken for a measurement. On a bus in        **
+** high-speed mode the pointer write ends with a repeated START so the device stays in HS mode for the read.      **
+*******************************************************************************************************************/
+bool INA226_Core::inaRead(uint8_t regAddr,uint8_t data[],uint8_t length,inaSTRUCT &unit) {
+  memset(data,0,length);                                                       // Zero unless read successfully
+  if (unit.address==0) {_TransmissionStatus = INA_I2C_NACK_ADDRESS; return(false);}// Unused unit, stay off the bus
+  inaBUS &bus = _buses[unit.bus];                                              // Bus the device is on
+  INA_TRANSPORT *wire = bus.wire;
+  uint32_t start = micros();                                                   // Time the transfer
+  bool success = false;
+  inaBUSHEALTH *health = inaHealth(unit);                                      // NULL without telemetry
+  if (health) health->transfers++;
+  for (uint8_t attempt=0;;attempt++) {
+    enterHighSpeed(bus);                                                       // Only if HS mode is turned on
+    wire->beginTransmission(unit.address);                                     // INA226 I2C Address
+    inaWireWrite(wire,regAddr);                                                // Send the register address to read
+    _TransmissionStatus = wire->endTransmission(bus.highSpeedClock==0);        // Repeated START keeps HS mode
+    _transactionCount++;                                                       // Pointer write
+    _byteCount += _TransmissionStatus==INA_I2C_NACK_ADDRESS ? 1 : 2;           // Address and pointer byte
+    if (_TransmissionStatus==0) {                                              // Pointer set, read the data
+      delayMicroseconds(I2C_DELAY);                                            // delay required for sync
+      uint8_t received = wire->requestFrom(unit.address,length,(uint8_t)true); // Request consecutive bytes
+      _transactionCount++;                                                     // Data read
+      _byteCount += 1+received;                                                // Address and data bytes
+      if (received>=length) {                                                  // Complete, MSB first
+        for (uint8_t i=0;i<length;i++) data[i] = inaWireRead(wire);
+        success = true;
+      } else {
+        while (received--) inaWireRead(wire);                                  // Discard partial data
+        _TransmissionStatus = INA_I2C_SHORT_READ;
+      }
+    }
+    leaveHighSpeed(bus);                                                       // STOP has ended HS mode
+    if (success || !retryTransfer(attempt,health)) break;                      // Done, or count it and back off
+  }
+  recordLatency(INA_LATENCY_READ,micros()-start);                              // Add to the histogram
+  return(success);
+} // END of method inaRead()
+
+/*******************************************************************************************************************
+** Method inaWrite sets the register pointer and writes "length" bytes, with the same retries as inaRead()        **
+*******************************************************************************************************************/
+bool INA226_Core::inaWrite(uint8_t regAddr,const uint8_t data[],uint8_t length,inaSTRUCT &unit) {
+  if (unit.address==0) {_TransmissionStatus = INA_I2C_NACK_ADDRESS; return(false);}// Unused unit, stay off the bus
+  inaBUS &bus = _buses[unit.bus];                                              // Bus the device is on
+  INA_TRANSPORT *wire = bus.wire;
+  uint32_t start = micros();                                                   // Time the transfer
+  bool success = false;
+  inaBUSHEALTH *health = inaHealth(unit);                                      // NULL without telemetry
+  if (health) health->transfers++;
+  for (uint8_t attempt=0;;attempt++) {
+    enterHighSpeed(bus);                                                       // Only if HS mode is turned on
+    wire->beginTransmission(unit.address);                                     // INA226 I2C Address
+    inaWireWrite(wire,regAddr);                                                // Send register address to write
+    for (uint8_t i=0;i<length;i++) inaWireWrite(wire,data[i]);                 // Send the data, MSB first
+    _TransmissionStatus = wire->endTransmission();                             // Close transmission
+    _transactionCount++;                                                       // Single write transaction
+    _byteCount += _TransmissionStatus==INA_I2C_NACK_ADDRESS ? 1 : 2+length;    // Address, pointer and data
+    leaveHighSpeed(bus);                                                       // STOP has ended HS mode
+    if (_TransmissionStatus==0) {success = true; break;}                       // Written
+    if (!retryTransfer(attempt,health)) break;                                 // Count it, give up or back off
+  }
+  recordLatency(INA_LATENCY_WRITE,micros()-start);                             // Add to the histogram
+  return(success);
+} // END of method inaWrite()
+
+/*******************************************************************************************************************
+** Methods enterHighSpeed and leaveHighSpeed wrap each transfer on a bus with HS mode turned on. The master code  **
+** is sent at the normal clock without a STOP, which no device acknowledges, then the clock is raised. The INA226 **
+** stays in HS mode until the next STOP, after which the normal clock is restored for the next master code.       **
+*******************************************************************************************************************/
+void INA226_Core::enterHighSpeed(inaBUS &bus) {
+#if INA_TRANSPORT_HIGH_SPEED
+  if (bus.highSpeedClock==0) return;                                           // HS mode not in use
+  bus.wire->beginTransmission(INA_HS_MASTER_CODE);                             // Master code 00001XXX
+  bus.wire->endTransmission(false);                                            // NACK is expected, no STOP
+  _transactionCount++;                                                         // Master code only
+  _byteCount++;
+  bus.wire->setClock(bus.highSpeedClock);                                      // Now switch to HS clock
+#else
+  (void)bus;                                                                   // Never in HS mode
+#endif
+} // END of method enterHighSpeed()
+
+void INA226_Core::leaveHighSpeed(inaBUS &bus) {
+#if INA_TRANSPORT_HIGH_SPEED
+  if (bus.highSpeedClock==0) return;                                           // HS mode not in use
+  bus.wire->setClock(bus.clock ? bus.clock : INA_I2C_STANDARD_CLOCK);          // Back to the normal clock
+#else
+  (void)bus;                                                                   // Never in HS mode
+#endif
+} // END of method leaveHighSpeed()
+
+/*******************************************************************************************************************
+** Method retryTransfer counts the error in _TransmissionStatus against the unit, if it has counters, then either **
+** gives up if all retries are used or waits out the backoff for this attempt and returns true to try again       **
+*******************************************************************************************************************/
+bool INA226_Core::retryTransfer(uint8_t attempt,inaBUSHEALTH *health) {
+  if (health) switch (_TransmissionStatus) {                                   // Classify the error
+    case INA_I2C_NACK_ADDRESS:
+    case INA_I2C_NACK_DATA:  inaCount(health->nacks);      break;
+    case INA_I2C_SHORT_READ: inaCount(health->shortReads); break;
+    case INA_I2C_TIMEOUT:    inaCount(health->timeouts);   break;
+    default:                 inaCount(health->busErrors);  break;
+  }
+  if (attempt>=_retries) {                                                     // Out of retries
+    if (health) inaCount(health->failures);
+    return(false);
+  }
+  if (health) inaCount(health->retries);
+  uint32_t backoff = (uint32_t)_backoff<<attempt;                              // Exponential backoff
+  delayMicroseconds(backoff>INA_I2C_MAX_BACKOFF ? INA_I2C_MAX_BACKOFF : backoff);
+  return(true);
+} // END of method retryTransfer()
+
+/*******************************************************************************************************************
+** Method recordLatency adds a transfer time to the histogram for its type. Bucket n counts transfers which took  **
+** from 2^n to 2^(n+1)-1 microseconds (bucket 0 also holds 0), the last bucket holds everything longer. Nothing   **
+** is recorded without setTelemetry().                                                                            **
+*******************************************************************************************************************/
+void INA226_Core::recordLatency(uint8_t type,uint32_t microSeconds) {
+  if (_telemetry==NULL) return;                                                // No histograms to add to
+  uint16_t *counts = _telemetry->latency(type);                                // Histogram of this type
+  uint8_t bucket = 0;
+  while (microSeconds>1 && bucket<INA_LATENCY_BUCKETS-1) {                     // Integer log2
+    microSeconds >>= 1;
+    bucket++;
+  }
+  inaCount(counts[bucket]);                                                    // Saturate, don't wrap
+} // END of method recordLatency()
+
 /*******************************************************************************************************************
 ** Method inaReadByte reads 1 byte from the specified address                                                     **
 *******************************************************************************************************************/
-uint8_t INA226_Class::inaReadByte(uint8_t regAddr,uint8_t deviceAddr) {
-  Wire.beginTransmission(deviceAddr);                                          // INA226 I2C Address
-  WIRE_WRITE(regAddr);                                                         // Send the register address to read
-  _TransmissionStatus = Wire.endTransmission();                                // Close transmission
-  delayMicroseconds(I2C_DELAY);                                                // delay required for sync
-  Wire.requestFrom(deviceAddr, (uint8_t)1);                                    // Request 1 byte of data
-  return WIRE_READ();                                                          // read it and return it
+uint8_t INA226_Core::inaReadByte(uint8_t regAddr,inaSTRUCT &unit) {
+  uint8_t data;                                                                // Byte read
+  inaRead(regAddr,&data,1,unit);                                               // Zero if the read failed
+  return data;                                                                 // return it
 } // END of method inaReadByte()
 
 /*******************************************************************************************************************
 ** Method inaReadWord reads 2 bytes from the specified address                                                    **
 *******************************************************************************************************************/
-int16_t INA226_Class::inaReadWord(uint8_t regAddr,uint8_t deviceAddr) {
-  int16_t returnData;                                                          // Store return value
-  Wire.beginTransmission(deviceAddr);                                          // INA226 I2C Address
-  WIRE_WRITE(regAddr);                                                         // Send the register address to read
-  _TransmissionStatus = Wire.endTransmission();                                // Close transmission
-  delayMicroseconds(I2C_DELAY);                                                // delay required for sync
-  Wire.requestFrom(deviceAddr, (uint8_t)2);                                    // Request 2 consecutive bytes
-  returnData = WIRE_READ();                                                    // Read the msb
-  returnData = returnData<<8;                                                  // shift the data over
-  returnData|= WIRE_READ();                                                    // Read the lsb
-  return returnData;                                                           // read it and return it
+int16_t INA226_Core::inaReadWord(uint8_t regAddr,inaSTRUCT &unit) {
+  uint8_t data[2];                                                             // MSB and LSB
+  inaRead(regAddr,data,2,unit);                                                // Zero if the read failed
+  return (int16_t)(((uint16_t)data[0]<<8)|data[1]);                            // combine and return
 } // END of method inaReadWord()
 
 /*******************************************************************************************************************
 ** Method inaWriteByte write 1 byte to the specified address                                                      **
 *******************************************************************************************************************/
-void INA226_Class::inaWriteByte(uint8_t regAddr,uint8_t regData,uint8_t deviceAddr) {
-  Wire.beginTransmission(deviceAddr);                                          // INA226 I2C Address
-  WIRE_WRITE(regAddr);                                                         // Send register address to write
-  WIRE_WRITE(regData);                                                         // Send the data to write
-  _TransmissionStatus = Wire.endTransmission();                                // Close transmission
+void INA226_Core::inaWriteByte(uint8_t regAddr,uint8_t regData,inaSTRUCT &unit) {
+  inaWrite(regAddr,&regData,1,unit);                                           // Send the data to write
 } // END of method inaWriteByte()
 
 /*******************************************************************************************************************
 ** Method inaWriteWord writes 2 byte to the specified address                                                     **
 *******************************************************************************************************************/
-void INA226_Class::inaWriteWord(uint8_t regAddr, uint16_t regData,uint8_t deviceAddr) {
-  Wire.beginTransmission(deviceAddr);                                          // INA226 I2C Address
-  WIRE_WRITE(regAddr);                                                         // Send register address to write
-  WIRE_WRITE((uint8_t)(regData>>8));                                           // Write the first byte
-  WIRE_WRITE((uint8_t)regData);                                                // and then the second
-  _TransmissionStatus = Wire.endTransmission();                                // Close transmission
+void INA226_Core::inaWriteWord(uint8_t regAddr, uint16_t regData,inaSTRUCT &unit) {
+  uint8_t data[2] = {(uint8_t)(regData>>8),(uint8_t)regData};                  // MSB first, then LSB
+  inaWrite(regAddr,data,2,unit);                                               // Send the data to write
 } // END of method inaWriteWord()
 
 /*******************************************************************************************************************
 ** Method getBusMilliVolts retrieves the bus voltage measurement                                                  **
 *******************************************************************************************************************/
-uint16_t INA226_Class::getBusMilliVolts(bool waitSwitch,uint8_t UNIT_ID) {
-  if (waitSwitch) waitForConversion();                                         // wait for conversion to complete
-  uint16_t busVoltage = inaReadWord(INA_BUS_VOLT_REG,inaARRAY[UNIT_ID].address);// Get the raw value and apply
+uint16_t INA226_Core::getBusMilliVolts(bool waitSwitch,uint8_t UNIT_ID) {
+  if (waitSwitch) waitForConversion(UNIT_ID);                                  // wait for conversion to complete
+  uint16_t busVoltage = inaReadWord(INA_BUS_VOLT_REG,inaUnit(UNIT_ID));        // Get the raw value and apply
   busVoltage = (uint32_t)busVoltage*INA_BUS_VOLT_LSB/100;                      // conversion to get milliVolts
-  if (!bitRead(inaARRAY[UNIT_ID].operatingMode,2) &&                           // If triggered mode and bus active
-       bitRead(inaARRAY[UNIT_ID].operatingMode,1)) {
-    int16_t configRegister = inaReadWord(INA_CONFIG_REG,inaARRAY[UNIT_ID].address);// Get the current register
-    inaWriteWord(INA_CONFIG_REG,configRegister,inaARRAY[UNIT_ID].address);     // Write back to trigger next
-  }
+  if (triggeredMode(UNIT_ID)) triggerConversion(UNIT_ID);                      // Start the next conversion
   return(busVoltage);                                                          // return computed milliVolts
 } // END of method getBusMilliVolts()
 
 /*******************************************************************************************************************
 ** Method getShuntMicroVolts retrieves the shunt voltage measurement                                              **
 *******************************************************************************************************************/
-int16_t INA226_Class::getShuntMicroVolts(bool waitSwitch,uint8_t UNIT_ID) {
-  if (waitSwitch) waitForConversion();                                         // wait for conversion to complete
-  int32_t shuntVoltage = inaReadWord(INA_SHUNT_VOLT_REG,inaARRAY[UNIT_ID].address);// Get the raw value
+int16_t INA226_Core::getShuntMicroVolts(bool waitSwitch,uint8_t UNIT_ID) {
+  if (waitSwitch) waitForConversion(UNIT_ID);                                  // wait for conversion to complete
+  int32_t shuntVoltage = inaReadWord(INA_SHUNT_VOLT_REG,inaUnit(UNIT_ID));     // Get the raw value
   shuntVoltage = shuntVoltage*INA_SHUNT_VOLT_LSB/10;                           // Convert to microvolts
-  if (!bitRead(inaARRAY[UNIT_ID].operatingMode,2) &&                           // If triggered mode and bus active
-       bitRead(inaARRAY[UNIT_ID].operatingMode,1)) {
-    int16_t configRegister = inaReadWord(INA_CONFIG_REG,inaARRAY[UNIT_ID].address);// Get the current register
-    inaWriteWord(INA_CONFIG_REG,configRegister,inaARRAY[UNIT_ID].address);     // Write back to trigger next
-  }
+  if (triggeredMode(UNIT_ID)) triggerConversion(UNIT_ID);                      // Start the next conversion
   return((int16_t)shuntVoltage);                                               // return computed microvolts
 } // END of method getShuntMicroVolts()
 
 /*******************************************************************************************************************
 ** Method getBusMicroAmps retrieves the computed current in microamps.                                            **
 *******************************************************************************************************************/
-int32_t INA226_Class::getBusMicroAmps(uint8_t UNIT_ID) {
-  int32_t microAmps = inaReadWord(INA_CURRENT_REGISTER,inaARRAY[UNIT_ID].address);// Get the raw value
-          microAmps = (int64_t)microAmps*inaARRAY[UNIT_ID].current_LSB/1000;   // Convert to microamps
+int32_t INA226_Core::getBusMicroAmps(uint8_t UNIT_ID) {
+  int32_t microAmps = inaReadWord(INA_CURRENT_REGISTER,inaUnit(UNIT_ID));      // Get the raw value
+          microAmps = inaScale(microAmps,inaUnit(UNIT_ID).lsbWhole,            // Convert to microamps
+                               inaUnit(UNIT_ID).lsbFraction);
   return(microAmps);                                                           // return computed microamps
 } // END of method getBusMicroAmps()
 
 /*******************************************************************************************************************
 ** Method getBusMicroWatts retrieves the computed power in milliwatts                                             **
 *******************************************************************************************************************/
-int32_t INA226_Class::getBusMicroWatts(uint8_t UNIT_ID) {
-  int32_t microWatts = inaReadWord(INA_POWER_REGISTER,inaARRAY[UNIT_ID].address);// Get the raw value
-          microWatts = (int64_t)microWatts*inaARRAY[UNIT_ID].power_LSB/1000;   // Convert to milliwatts
+int32_t INA226_Core::getBusMicroWatts(uint8_t UNIT_ID) {
+  int32_t microWatts = (uint16_t)inaReadWord(INA_POWER_REGISTER,inaUnit(UNIT_ID)); // Get the unsigned raw value
+          microWatts = inaScale(25*microWatts,inaUnit(UNIT_ID).lsbWhole,       // Convert to microwatts, the
+                                inaUnit(UNIT_ID).lsbFraction);                 // power_LSB is 25 current_LSBs
   return(microWatts);                                                          // return computed milliwatts
 } // END of method getBusMicroWatts()
 
+/*******************************************************************************************************************
+** Method readAll retrieves a complete sample from one device. Only the shunt and bus voltage registers are read, **
+** the current and power values are derived from the shunt and bus values that were read, using the same          **
+** equations the INA226 applies internally (datasheet equations 3 and 4), so they always match the returned       **
+** voltages and cost two register reads instead of four. In continuous mode a conversion can complete between the **
+** two reads, so the shunt and bus values may come from consecutive conversions; in triggered mode both belong to **
+** the conversion that was waited for, and the next one is started only once, after both registers are read.      **
+** The accumulators are fed with the time taken before the reads, as readRaw() does, so neither the I2C transfers **
+** nor the retrigger shift the integration interval.                                                              **
+*******************************************************************************************************************/
+inaREADING INA226_Core::readAll(uint8_t UNIT_ID) {
+  inaREADING reading;                                                          // Hold the values to return
+  uint32_t   timestamp = micros();                                             // Time of the read
+  reading.shuntRaw   = inaReadWord(INA_SHUNT_VOLT_REG,inaUnit(UNIT_ID));       // Get the raw shunt value
+  reading.busRaw     = inaReadWord(INA_BUS_VOLT_REG,inaUnit(UNIT_ID));         // Get the raw bus value
+  reading.currentRaw = inaCurrentRaw(reading.shuntRaw,inaUnit(UNIT_ID).calibration); // Current = Shunt*Cal/2048
+  reading.powerRaw   = inaPowerRaw(reading.currentRaw,reading.busRaw);         // Power = Current*Bus/20000
+  reading.shuntMicroVolts = (int32_t)reading.shuntRaw*INA_SHUNT_VOLT_LSB/10;   // Convert to microvolts
+  reading.busMilliVolts   = (uint32_t)reading.busRaw*INA_BUS_VOLT_LSB/100;     // Convert to millivolts
+  reading.busMicroAmps    = inaScale(reading.currentRaw,inaUnit(UNIT_ID).lsbWhole,   // Convert to microamps
+                                     inaUnit(UNIT_ID).lsbFraction);
+  reading.busMicroWatts   = inaScale(25*(int32_t)reading.powerRaw,inaUnit(UNIT_ID).lsbWhole, // and microwatts
+                                     inaUnit(UNIT_ID).lsbFraction);
+  if (triggeredMode(UNIT_ID)) triggerConversion(UNIT_ID);                      // Start the next conversion
+  inaACCUMULATOR *acc = inaAccumulator(UNIT_ID);                               // NULL without accumulators
+  if (acc && acc->accumulating) accumulate(reading,timestamp,UNIT_ID);         // Feed the accumulators
+  return(reading);                                                             // return the complete sample
+} // END of method readAll()
+
+/*******************************************************************************************************************
+** Method readRaw reads the shunt and bus voltage registers and returns them unscaled with a timestamp, leaving   **
+** all conversion work to the batch converters below. In triggered mode the next conversion is started.           **
+*******************************************************************************************************************/
+inaSAMPLE INA226_Core::readRaw(uint8_t UNIT_ID) {
+  inaSAMPLE sample;                                                            // Hold the values to return
+  sample.micros   = micros();                                                  // Time of the read
+  sample.unit     = UNIT_ID;
+  sample.shuntRaw = inaReadWord(INA_SHUNT_VOLT_REG,inaUnit(UNIT_ID));          // Get the raw shunt value
+  sample.busRaw   = inaReadWord(INA_BUS_VOLT_REG,inaUnit(UNIT_ID));            // Get the raw bus value
+  if (triggeredMode(UNIT_ID)) triggerConversion(UNIT_ID);                      // Start the next conversion
+  return(sample);                                                              // return the raw sample
+} // END of method readRaw()
+
+/*******************************************************************************************************************
+** Method fixedPoint returns the fraction of nanoLSB/1000 with INA_FIXED_POINT_SHIFT (31) fraction bits, below    **
+** 2^31. It is rounded up, so for a value below 2^21, e.g. 25 times a raw power value, the product is high by     **
+** less than 2^21/2^31 < 1/1000 of a micro unit. value*nanoLSB/1000 is a multiple of 1/1000, so the excess never  **
+** reaches the next whole unit and inaScale() equals the truncated division value*nanoLSB/1000 for every raw      **
+** value. The whole part and the fraction are each 32 bits, the fraction also gives back the remainder of         **
+** nanoLSB/1000 for getCurrentLSB().                                                                              **
+*******************************************************************************************************************/
+uint32_t INA226_Core::fixedPoint(uint32_t nanoLSB) {
+  return((((uint64_t)(nanoLSB%1000)<<INA_FIXED_POINT_SHIFT)+999)/1000);        // return rounded up fraction
+} // END of method fixedPoint()
+
+/*******************************************************************************************************************
+** Batch converters. These scale arrays of raw register values without any run-time division: the voltage LSBs    **
+** are compile-time constants and current and power use each unit's LSB as whole and fixed point fraction, copied **
+** to locals so the loops don't reload them from the unit table.                                                  **
+*******************************************************************************************************************/
+void INA226_Core::convertShunt(const int16_t shuntRaw[],int32_t microVolts[],uint16_t count) {
+  for (uint16_t i=0;i<count;i++)                                               // 2.5uV per LSB
+    microVolts[i] = (int32_t)shuntRaw[i]*INA_SHUNT_VOLT_LSB/10;
+} // END of method convertShunt()
+
+void INA226_Core::convertBus(const uint16_t busRaw[],uint32_t milliVolts[],uint16_t count) {
+  for (uint16_t i=0;i<count;i++)                                               // 1.25mV per LSB
+    milliVolts[i] = (uint32_t)busRaw[i]*INA_BUS_VOLT_LSB/100;
+} // END of method convertBus()
+
+void INA226_Core::convertCurrent(const int16_t shuntRaw[],int32_t microAmps[],uint16_t count,uint8_t UNIT_ID) {
+  const int32_t  calibration = inaUnit(UNIT_ID).calibration;                   // Copy per-unit values to locals
+  const uint32_t whole       = inaUnit(UNIT_ID).lsbWhole;                      // so the loop has no memory
+  const uint32_t fraction    = inaUnit(UNIT_ID).lsbFraction;                   // dependencies on the table
+  for (uint16_t i=0;i<count;i++) {
+    int16_t currentRaw = inaCurrentRaw(shuntRaw[i],calibration);               // Current = Shunt*Cal/2048
+    microAmps[i] = inaScale(currentRaw,whole,fraction);                        // Scale to microamps
+  }
+} // END of method convertCurrent()
+
+void INA226_Core::convertPower(const int16_t shuntRaw[],const uint16_t busRaw[],int32_t microWatts[],
+                               uint16_t count,uint8_t UNIT_ID) {
+  const int32_t  calibration = inaUnit(UNIT_ID).calibration;                   // Copy per-unit values to locals
+  const uint32_t whole       = inaUnit(UNIT_ID).lsbWhole;
+  const uint32_t fraction    = inaUnit(UNIT_ID).lsbFraction;
+  for (uint16_t i=0;i<count;i++) {
+    int16_t  currentRaw = inaCurrentRaw(shuntRaw[i],calibration);              // Current = Shunt*Cal/2048
+    uint16_t powerRaw   = inaPowerRaw(currentRaw,busRaw[i]);                   // Power = Current*Bus/20000
+    microWatts[i] = inaScale(25*(int32_t)powerRaw,whole,fraction);             // Scale to microwatts
+  }
+} // END of method convertPower()
+
+/*******************************************************************************************************************
+** Method convertSamples scales raw samples from the ring buffer, which may come from different units, into full  **
+** readings using the same fixed point arithmetic as the batch converters                                         **
+*******************************************************************************************************************/
+void INA226_Core::convertSamples(const inaSAMPLE samples[],inaREADING readings[],uint16_t count) {
+  for (uint16_t i=0;i<count;i++) {
+    inaSTRUCT &unit = inaUnit(samples[i].unit);                                // Bounds checked entry
+    readings[i].shuntRaw   = samples[i].shuntRaw;
+    readings[i].busRaw     = samples[i].busRaw;
+    readings[i].currentRaw = inaCurrentRaw(samples[i].shuntRaw,unit.calibration);// Current = Shunt*Cal/2048
+    readings[i].powerRaw   = inaPowerRaw(readings[i].currentRaw,samples[i].busRaw);// Power = Current*Bus/20000
+    readings[i].shuntMicroVolts = (int32_t)samples[i].shuntRaw*INA_SHUNT_VOLT_LSB/10;
+    readings[i].busMilliVolts   = (uint32_t)samples[i].busRaw*INA_BUS_VOLT_LSB/100;
+    readings[i].busMicroAmps    = inaScale(readings[i].currentRaw,unit.lsbWhole,unit.lsbFraction);
+    readings[i].busMicroWatts   = inaScale(25*(int32_t)readings[i].powerRaw,unit.lsbWhole,unit.lsbFraction);
+  }
+} // END of method convertSamples()
+
+/*******************************************************************************************************************
+** Methods getTransactionCount and getByteCount return the number of I2C transactions and bytes (including the    **
+** address bytes) sent since the last resetBusCounters() call, allowing the bus cost of a sample to be measured   **
+*******************************************************************************************************************/
+uint32_t INA226_Core::getTransactionCount() {
+  return(_transactionCount);                                                   // return transaction count
+} // END of method getTransactionCount
+
+uint32_t INA226_Core::getByteCount() {
+  return(_byteCount);                                                          // return byte count
+} // END of method getByteCount
+
+void INA226_Core::resetBusCounters() {
+  _transactionCount = 0;                                                       // Zero the transactions
+  _byteCount        = 0;                                                       // Zero the bytes
+  if (_telemetry)                                                              // Zero the latency histograms
+    memset(_telemetry->latency(0),0,sizeof(uint16_t)*INA_LATENCY_TYPES*INA_LATENCY_BUCKETS);
+} // END of method resetBusCounters
+
+/*******************************************************************************************************************
+** Method setRetries sets how often a failed register read or write is repeated and the delay before the first    **
+** retry, which doubles for each following one. Zero retries gives the original single attempt behavior           **
+*******************************************************************************************************************/
+void INA226_Core::setRetries(uint8_t retries,uint16_t backoffMicros) {
+  _retries = retries>INA_I2C_MAX_RETRIES ? INA_I2C_MAX_RETRIES : retries;      // Keep the worst case bounded
+  _backoff = backoffMicros;
+} // END of method setRetries()
+
+/*******************************************************************************************************************
+** Method getTransmissionStatus returns the result of the last transfer, 0 for success, the Wire                  **
+** endTransmission() error codes or INA_I2C_SHORT_READ                                                            **
+*******************************************************************************************************************/
+uint8_t INA226_Core::getTransmissionStatus() {
+  return(_TransmissionStatus);                                                 // return last status
+} // END of method getTransmissionStatus()
+
+/*******************************************************************************************************************
+** Method setTelemetry gives the library the storage for the I2C error counters and latency histograms, see       **
+** INA226_Telemetry. Until it is called nothing is counted. The set is cleared for a fresh start.                 **
+*******************************************************************************************************************/
+void INA226_Core::setTelemetry(INA226_TelemetrySet &telemetry) {              // Storage for the bus telemetry
+  _telemetry = &telemetry;                                                     // Store the set
+  _telemetry->clear();                                                         // and start from zero
+} // END of method setTelemetry()
+
+/*******************************************************************************************************************
+** Method inaHealth returns the I2C error counters for a table entry, or NULL without setTelemetry(). The spare   **
+** entry, and units beyond the end of the set, share the counters for addresses not in the table.                 **
+*******************************************************************************************************************/
+inaBUSHEALTH* INA226_Core::inaHealth(inaSTRUCT &unit) {
+  if (_telemetry==NULL) return(NULL);                                          // Nothing to count in
+  return(_telemetry->unit(&unit-inaARRAY));                                    // Entry by position in the table
+} // END of method inaHealth()
+
+/*******************************************************************************************************************
+** Methods getBusHealth and resetBusHealth return and zero the I2C error counters of a unit. Out of range UNIT_ID **
+** values return the counters for traffic to addresses not in the table. Without setTelemetry() the counters are  **
+** all zero.                                                                                                      **
+*******************************************************************************************************************/
+inaBUSHEALTH INA226_Core::getBusHealth(uint8_t UNIT_ID) {
+  inaBUSHEALTH health = {};                                                    // Zeros without telemetry
+  inaBUSHEALTH *counters = inaHealth(inaUnit(UNIT_ID));
+  if (counters) health = *counters;                                            // Copy of the counters
+  return(health);                                                              // return copy of the counters
+} // END of method getBusHealth()
+
+void INA226_Core::resetBusHealth(uint8_t UNIT_ID) {
+  inaBUSHEALTH *health = inaHealth(inaUnit(UNIT_ID));                          // NULL without telemetry
+  if (health) memset(health,0,sizeof(inaBUSHEALTH));                           // Zero the counters
+} // END of method resetBusHealth()
+
+/*******************************************************************************************************************
+** Method getLatencyCount returns the number of transfers of the given INA_LATENCY_ type in a histogram bucket,   **
+** getLatencyPercentile returns the upper bound in microseconds of the bucket holding the given percentile.       **
+** The histograms are zeroed along with the other bus counters by resetBusCounters() and are only kept after      **
+** setTelemetry(), both return 0 without it.                                                                      **
+*******************************************************************************************************************/
+uint16_t INA226_Core::getLatencyCount(uint8_t type,uint8_t bucket) {
+  if (_telemetry==NULL || type>=INA_LATENCY_TYPES || bucket>=INA_LATENCY_BUCKETS) return(0);// Nothing to return
+  return(_telemetry->latency(type)[bucket]);                                   // return bucket count
+} // END of method getLatencyCount()
+
+uint32_t INA226_Core::getLatencyPercentile(uint8_t type,uint8_t percent) {
+  if (_telemetry==NULL || type>=INA_LATENCY_TYPES) return(0);                  // Nothing to return
+  const uint16_t *counts = _telemetry->latency(type);                          // Histogram of this type
+  uint32_t total = 0;                                                          // Transfers in the histogram
+  for (uint8_t bucket=0;bucket<INA_LATENCY_BUCKETS;bucket++) total += counts[bucket];
+  if (total==0) return(0);                                                     // Nothing recorded yet
+  uint32_t rank = (total*(percent>100 ? 100 : percent)+99)/100;                // Transfers at or below percentile
+  if (rank==0) rank = 1;
+  uint32_t seen = 0;
+  for (uint8_t bucket=0;bucket<INA_LATENCY_BUCKETS;bucket++) {
+    seen += counts[bucket];
+    if (seen>=rank) return(((uint32_t)2<<bucket)-1);                           // Upper bound of this bucket
+  }
+  return(0xFFFFFFFF);                                                          // Not reached
+} // END of method getLatencyPercentile()
+
 /*******************************************************************************************************************
 ** Method to return the I2C Address value from inaSTRUCT for a given INA226 by UNIT_ID                                      **
 *******************************************************************************************************************/
-uint8_t INA226_Class::getAddress(uint8_t UNIT_ID) {
-  return(inaARRAY[UNIT_ID].address);                                       // return I2C Address
+uint8_t INA226_Core::getAddress(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).address);                                        // return I2C Address
 } // END of method getAddress
 
 /*******************************************************************************************************************
 ** Method to return the calibration value from inaSTRUCT for a given INA226 by UNIT_ID                                      **
 *******************************************************************************************************************/
-uint16_t INA226_Class::getCalibration(uint8_t UNIT_ID) {
-  return(inaARRAY[UNIT_ID].calibration);                                       // return calibration value
+uint16_t INA226_Core::getCalibration(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).calibration);                                        // return calibration value
 } // END of method getCalibration
 
 /*******************************************************************************************************************
 ** Method to return the current_LSB value from inaSTRUCT for a given INA226 by UNIT_ID                                      **
 *******************************************************************************************************************/
-uint32_t INA226_Class::getCurrentLSB(uint8_t UNIT_ID) {
-  return(inaARRAY[UNIT_ID].current_LSB);                                       // return current_LSB value
+uint32_t INA226_Core::getCurrentLSB(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).lsbWhole*1000+                                       // return current_LSB value,
+         (uint32_t)((uint64_t)inaUnit(UNIT_ID).lsbFraction*1000>>INA_FIXED_POINT_SHIFT)); // nA from whole+fraction
 } // END of method getCurrentLSB
 
 /*******************************************************************************************************************
 ** Method to return the power_LSB value from inaSTRUCT for a given INA226 by UNIT_ID                                      **
 *******************************************************************************************************************/
-uint32_t INA226_Class::getPowerLSB(uint8_t UNIT_ID) {
-  return(inaARRAY[UNIT_ID].power_LSB);                                         // return power_LSB value
+uint32_t INA226_Core::getPowerLSB(uint8_t UNIT_ID) {
+  return(25*getCurrentLSB(UNIT_ID));                                           // Fixed multiplier for INA226
 } // END of method getPowerLSB
 
 /*******************************************************************************************************************
-** Method the operatingMode value from inaSTRUCT for a given INA226 by UNIT_ID                                      **
+** Method getOperatingMode returns the mode bits of the shadow configuration register for a given UNIT_ID         **
 *******************************************************************************************************************/
-uint8_t INA226_Class::getOperatingMode(uint8_t UNIT_ID) {
-  return(inaARRAY[UNIT_ID].operatingMode);                                     // return calibration value
+uint8_t INA226_Core::getOperatingMode(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).configRegister & INA_CONFIG_MODE_MASK);             // return the mode bits
 } // END of method getOperatingMode
 
 /*******************************************************************************************************************
 ** Method setMode allows the various mode combinations to be set. If no parameter is given the system goes back   **
 ** to the default startup mode.                                                                                   **
 *******************************************************************************************************************/
-void INA226_Class::setMode(uint8_t mode,uint8_t UNIT_ID ) {                    // Set the monitoring mode
-  int16_t configRegister;                                                      // Hold configuration register
-  configRegister = inaReadWord(INA_CONFIG_REG,inaARRAY[UNIT_ID].address);      // Get the current register
-  configRegister &= ~INA_CONFIG_MODE_MASK;                                     // zero out the mode bits
-  inaARRAY[UNIT_ID].operatingMode = B00001111 & mode;                          // Mask off unused bits
-   configRegister |= inaARRAY[UNIT_ID].operatingMode;                          // shift in the mode settings
-  inaWriteWord(INA_CONFIG_REG,configRegister,inaARRAY[UNIT_ID].address);       // Save new value
+void INA226_Core::setMode(uint8_t mode,uint8_t UNIT_ID ) {                     // Set the monitoring mode
+  configure(UNIT_ID).mode(mode).apply();                                       // Single write from shadow
 } // END of method setMode()
 
 /*******************************************************************************************************************
 ** Method setAveraging sets the hardware averaging for the different devices                                      **
 *******************************************************************************************************************/
-void INA226_Class::setAveraging(uint16_t averages,uint8_t UNIT_ID ) {          // Set the number of averages taken
-  uint8_t averageIndex;                                                        // Store indexed value for register
-  int16_t configRegister;                                                      // Configuration register contents
-  configRegister = inaReadWord(INA_CONFIG_REG,inaARRAY[UNIT_ID].address);      // Get the current register
-  if      (averages>=1024) averageIndex = 7;                                   // setting depending upon range
-  else if (averages>= 512) averageIndex = 6;
-  else if (averages>= 256) averageIndex = 5;
-  else if (averages>= 128) averageIndex = 4;
-  else if (averages>=  64) averageIndex = 3;
-  else if (averages>=  16) averageIndex = 2;
-  else if (averages>=   4) averageIndex = 1;
-  else                     averageIndex = 0;
-  configRegister &= ~INA_CONFIG_AVG_MASK;                                      // zero out the averages part
-  configRegister |= (uint16_t)averageIndex << 9;                               // shift in the averages to register
-  inaWriteWord(INA_CONFIG_REG,configRegister,inaARRAY[UNIT_ID].address);       // Save new value
+void INA226_Core::setAveraging(uint16_t averages,uint8_t UNIT_ID ) {           // Set the number of averages taken
+  configure(UNIT_ID).averaging(averages).apply();                              // Single write from shadow
 } // END of method setAveraging()
 
 /*******************************************************************************************************************
 ** Method setBusConversion specifies the conversion rate (see datasheet for 8 distinct values) for the bus        **
 *******************************************************************************************************************/
-void INA226_Class::setBusConversion(uint8_t convTime,uint8_t UNIT_ID ) {       // Set timing for Bus conversions
-  int16_t configRegister;                                                      // Store configuration register
-  if (convTime>7) convTime=7;                                                  // Use maximum value allowed
-  configRegister = inaReadWord(INA_CONFIG_REG,inaARRAY[UNIT_ID].address);      // Get the current register
-  configRegister &= ~INA_BUS_TIME_MASK;                                        // zero out the Bus conversion part
-  configRegister |= (uint16_t)convTime << 6;                                   // shift in the averages to register
-  inaWriteWord(INA_CONFIG_REG,configRegister,inaARRAY[UNIT_ID].address);       // Save new value
+void INA226_Core::setBusConversion(uint8_t convTime,uint8_t UNIT_ID ) {        // Set timing for Bus conversions
+  configure(UNIT_ID).busConversion(convTime).apply();                          // Single write from shadow
 } // END of method setBusConversion()
 
 /*******************************************************************************************************************
 ** Method setShuntConversion specifies the conversion rate (see datasheet for 8 distinct values) for the shunt    **
 *******************************************************************************************************************/
-void INA226_Class::setShuntConversion(uint8_t convTime,uint8_t UNIT_ID ) {     // Set timing for Bus conversions
-  int16_t configRegister;                                                      // Store configuration register
-  if (convTime>7) convTime=7;                                                  // Use maximum value allowed
-  configRegister = inaReadWord(INA_CONFIG_REG,inaARRAY[UNIT_ID].address);      // Get the current register
-  configRegister &= ~INA_SHUNT_TIME_MASK;                                      // zero out the Bus conversion part
-  configRegister |= (uint16_t)convTime << 3;                                   // shift in the averages to register
-  inaWriteWord(INA_CONFIG_REG,configRegister,inaARRAY[UNIT_ID].address);       // Save new value
+void INA226_Core::setShuntConversion(uint8_t convTime,uint8_t UNIT_ID ) {      // Set timing for Bus conversions
+  configure(UNIT_ID).shuntConversion(convTime).apply();                        // Single write from shadow
 } // END of method setShuntConversion()
 
+/*******************************************************************************************************************
+** Method averagingIndex converts a number of averages into the 3-bit code used in the configuration register,    **
+** rounding down to the nearest value the INA226 supports                                                         **
+*******************************************************************************************************************/
+uint8_t INA226_Core::averagingIndex(uint16_t averages) {                       // Convert averages to register code
+  if      (averages>=1024) return 7;                                           // setting depending upon range
+  else if (averages>= 512) return 6;
+  else if (averages>= 256) return 5;
+  else if (averages>= 128) return 4;
+  else if (averages>=  64) return 3;
+  else if (averages>=  16) return 2;
+  else if (averages>=   4) return 1;
+  else                     return 0;
+} // END of method averagingIndex()
+
+/*******************************************************************************************************************
+** Method configure returns a builder which starts from the shadow configuration register. Settings are chained   **
+** and written to the device in a single transaction when apply() is called, e.g.                                 **
+**   INA226.configure(0).averaging(64).busConversion(4).shuntConversion(4).mode(INA_CONTINUOUS_BOTH).apply();     **
+*******************************************************************************************************************/
+INA226_Config INA226_Core::configure(uint8_t UNIT_ID) {                        // Batch config changes, one write
+  return INA226_Config(*this,UNIT_ID,inaUnit(UNIT_ID).configRegister);         // Builder from shadow value
+} // END of method configure()
+
+/*******************************************************************************************************************
+** Method getConfiguration returns the shadow copy of the configuration register without any I2C traffic          **
+*******************************************************************************************************************/
+uint16_t INA226_Core::getConfiguration(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).configRegister);                                     // return shadow config register
+} // END of method getConfiguration
+
+/*******************************************************************************************************************
+** Method writeConfig writes a configuration register value to the device and keeps the shadow values in step     **
+*******************************************************************************************************************/
+void INA226_Core::writeConfig(uint16_t configRegister,uint8_t UNIT_ID) {       // Write and shadow config register
+  configRegister &= ~INA_RESET_DEVICE;                                         // Never reset through this path
+  inaUnit(UNIT_ID).configRegister = configRegister;                            // Store the shadow value
+  inaWriteWord(INA_CONFIG_REG,configRegister,inaUnit(UNIT_ID));                // Save new value
+  inaUnit(UNIT_ID).conversionStart = micros();                                 // Writing restarts the conversion
+  inaUnit(UNIT_ID).lastPoll = inaUnit(UNIT_ID).conversionStart;
+} // END of method writeConfig()
+
+/*******************************************************************************************************************
+** Method triggerConversion starts the next conversion in triggered mode by writing the shadow configuration      **
+** register back to the device, no read of the device is needed                                                   **
+*******************************************************************************************************************/
+void INA226_Core::triggerConversion(uint8_t UNIT_ID) {                         // Start next triggered conversion
+  inaWriteWord(INA_CONFIG_REG,inaUnit(UNIT_ID).configRegister,                 // Write shadow back to trigger
+               inaUnit(UNIT_ID));                                              // the next conversion
+  inaUnit(UNIT_ID).conversionStart = micros();                                 // Remember when it started
+  inaUnit(UNIT_ID).lastPoll = inaUnit(UNIT_ID).conversionStart;
+} // END of method triggerConversion()
+
+/*******************************************************************************************************************
+** Method resyncRegisters reloads the shadow configuration, mask/enable and alert limit registers from the        **
+** device. Use it when the INA226 might have been reset or reconfigured outside of the library. The calibration   **
+** register is not a shadow but comes from begin(), so it is read back and rewritten if it differs, e.g. 0 after  **
+** a reset. Reading the mask/enable register also clears the conversion ready flag and the alert pin if latching  **
+** is enabled.                                                                                                    **
+*******************************************************************************************************************/
+void INA226_Core::resyncRegisters(uint8_t UNIT_ID) {                           // Reload shadows from the device
+  inaUnit(UNIT_ID).configRegister = inaReadWord(INA_CONFIG_REG,inaUnit(UNIT_ID));
+  inaUnit(UNIT_ID).maskRegister   = inaReadWord(INA_MASK_ENABLE_REG,inaUnit(UNIT_ID)) &
+                                     INA_MASK_ENABLE_RW_MASK;                  // Only keep the writable bits
+  inaUnit(UNIT_ID).alertLimit     = inaReadWord(INA_ALERT_LIMIT_REG,inaUnit(UNIT_ID));
+  if (inaReadWord(INA_CALIBRATION_REG,inaUnit(UNIT_ID))!=inaUnit(UNIT_ID).calibration) // Lost, e.g. by a reset
+    inaWriteWord(INA_CALIBRATION_REG,inaUnit(UNIT_ID).calibration,              // Restore the calibration value
+                 inaUnit(UNIT_ID));
+} // END of method resyncRegisters()
+
 /*******************************************************************************************************************
 ** Method waitForConversion loops until the current conversion is marked as finished. If the conversion has       **
-** completed already then the flag (and interrupt pin, if activated) is also reset.                               **
+** completed already then the flag (and interrupt pin, if activated) is also reset. The loop uses poll() so the   **
+** bus is only queried at a limited rate and the method returns false if the device does not finish in time.      **
 *******************************************************************************************************************/
-void INA226_Class::waitForConversion(uint8_t UNIT_ID) {                        // Wait for current conversion
-  uint16_t conversionBits = 0;
-  while(conversionBits==0) {
-    conversionBits = inaReadWord(INA_MASK_ENABLE_REG,inaARRAY[UNIT_ID].address) &(uint16_t)8;
-  }
+bool INA226_Core::waitForConversion(uint8_t UNIT_ID) {                         // Wait for current conversion
+  uint8_t status;                                                              // Hold poll result
+  do status = poll(UNIT_ID); while (status==INA_POLL_PENDING);                 // Loop until ready or timed out
+  return(status==INA_POLL_READY);                                              // true if the conversion finished
 } // END of method waitForConversion()
 
+/*******************************************************************************************************************
+** Method getConversionMicros returns the time in microseconds a complete conversion takes with the current       **
+** shadow configuration, i.e. the number of averages times the sum of the active bus and shunt conversion times   **
+*******************************************************************************************************************/
+uint32_t INA226_Core::getConversionMicros(uint8_t UNIT_ID) {                   // Expected time per conversion
+  return(conversionMicros(inaUnit(UNIT_ID).configRegister));                   // Work from the shadow register
+} // END of method getConversionMicros()
+
+uint32_t INA226_Core::conversionMicros(uint16_t configRegister) {              // Time per conversion of a setting
+  uint32_t conversionTime = 0;                                                 // Sum of active conversion times
+  if (bitRead(configRegister,0))                                               // Shunt measurement active
+    conversionTime += pgm_read_word(&inaConversionMicros[(configRegister&INA_SHUNT_TIME_MASK)>>3]);
+  if (bitRead(configRegister,1))                                               // Bus measurement active
+    conversionTime += pgm_read_word(&inaConversionMicros[(configRegister&INA_BUS_TIME_MASK)>>6]);
+  return(conversionTime*pgm_read_word(&inaAverages[(configRegister&INA_CONFIG_AVG_MASK)>>9]));
+} // END of method conversionMicros()
+
+/*******************************************************************************************************************
+** Method tuneSetting searches all averaging and conversion time combinations, the same conversion time being     **
+** used for the bus and the shunt, for the one to use with the active channels of configRegister. The noise of a  **
+** reading falls with the square root of the shunt integration time (averages times conversion time), so without  **
+** minIntegration the setting with the longest integration that fits in maxPeriod is chosen. With minIntegration  **
+** the fastest setting integrating at least that long is chosen instead, if there is one within maxPeriod.        **
+*******************************************************************************************************************/
+uint16_t INA226_Core::tuneSetting(uint16_t configRegister,uint32_t maxPeriod,uint32_t minIntegration) {
+  uint8_t  channels = bitRead(configRegister,0)+bitRead(configRegister,1);     // Conversions per sample
+  if (channels==0) channels = 2;                                               // Powered down, assume both
+  uint8_t  bestAverages = 0, bestTime = 0;                                     // Fastest setting if none fits
+  uint32_t bestIntegration = 0, bestPeriod = 0;
+  bool     found = false;
+  for (uint8_t averages=0;averages<8;averages++) {
+    for (uint8_t time=0;time<8;time++) {
+      uint32_t integration = (uint32_t)pgm_read_word(&inaAverages[averages])*  // Shunt integration time
+                             pgm_read_word(&inaConversionMicros[time]);
+      uint32_t period      = integration*channels;                             // Sample period of the setting
+      if (period>maxPeriod) continue;                                          // Too slow for the target rate
+      bool meets     = minIntegration && integration>=minIntegration;          // Quiet enough for the target
+      bool bestMeets = minIntegration && bestIntegration>=minIntegration;
+      bool better;
+      if (!found || meets!=bestMeets) better = !found || meets;                // Meeting the noise target wins
+      else if (meets) better = period<bestPeriod ||                            // then the fastest of those
+                               (period==bestPeriod && integration>bestIntegration);
+      else            better = integration>bestIntegration ||                  // or else the quietest
+                               (integration==bestIntegration && period<bestPeriod);
+      if (!better) continue;
+      bestAverages = averages; bestTime = time;
+      bestIntegration = integration; bestPeriod = period;
+      found = true;
+    }
+  }
+  configRegister &= ~(INA_CONFIG_AVG_MASK|INA_BUS_TIME_MASK|INA_SHUNT_TIME_MASK);// Keep the mode bits
+  return(configRegister|(uint16_t)bestAverages<<9|(uint16_t)bestTime<<6|(uint16_t)bestTime<<3);
+} // END of method tuneSetting()
+
+/*******************************************************************************************************************
+** Method tuneFor sets the averaging and conversion times giving the lowest noise at which the unit still         **
+** delivers targetHz samples per second with its current mode, so set the mode first. A targetHz of 0 removes the **
+** limit, rates above 1MHz are kept as a 1us period limit. The rate is remembered in the unit's accumulator as    **
+** the limit for adaptTuning(), so call setAccumulators() first when adaptTuning() is used. Returns the resulting **
+** sample period in microseconds, which is longer than 1/targetHz only if the rate is beyond the fastest setting. **
+*******************************************************************************************************************/
+uint32_t INA226_Core::tuneFor(uint32_t targetHz,uint8_t UNIT_ID) {             // Lowest noise meeting the rate
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Bounds checked entry
+  uint32_t period = targetHz==0 ? 0 : targetHz>1000000 ? 1 : 1000000/targetHz; // 0 is no limit, at least 1us
+  inaACCUMULATOR *acc = inaAccumulator(UNIT_ID);                               // NULL without accumulators
+  if (acc) acc->tunePeriod = period;                                           // Limit for adaptTuning()
+  uint16_t configRegister = tuneSetting(unit.configRegister,period ? period : 0xFFFFFFFF,0);
+  if (configRegister!=unit.configRegister) writeConfig(configRegister,UNIT_ID);// Only write if changed
+  return(getConversionMicros(UNIT_ID));                                        // return effective period
+} // END of method tuneFor()
+
+/*******************************************************************************************************************
+** Method adaptTuning adjusts the setting from the measured noise. The shunt voltage noise is taken from the      **
+** current variance of the accumulators (see setAccumulating()) and the shunt resistance, so it includes any real **
+** change of the load and is meant for steady loads. Above noiseMicroVolts the integration time is increased as   **
+** far as the tuneFor() rate allows, below half of it the fastest setting expected to stay under noiseMicroVolts  **
+** is used. Quantisation noise of the 2.5uV LSB is the floor of the estimate. The statistics are reset after a    **
+** change so the next call measures the new setting. Returns the resulting sample period in microseconds.         **
+*******************************************************************************************************************/
+uint32_t INA226_Core::adaptTuning(uint16_t noiseMicroVolts,uint8_t UNIT_ID) {  // Fastest meeting the noise target
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Bounds checked entry
+  inaACCUMULATOR *acc = inaAccumulator(UNIT_ID);                               // NULL without accumulators
+  if (!acc || !acc->accumulating || acc->samples<INA_TUNE_MIN_SAMPLES || noiseMicroVolts==0)
+    return(getConversionMicros(UNIT_ID));                                      // Nothing to go by
+  inaSTATISTICS statistics;
+  getStatistics(statistics,false,UNIT_ID);
+  float noise = sqrt(statistics.busMicroAmps.variance)*unit.microOhms/1000000; // Shunt noise, uV rms
+  if (noise<0.72) noise = 0.72;                                                // 2.5uV LSB/sqrt(12)
+  if (noise<=noiseMicroVolts && noise*2>=noiseMicroVolts)                      // Within the band, keep it
+    return(getConversionMicros(UNIT_ID));
+  uint16_t configRegister = unit.configRegister;
+  float integration = (float)pgm_read_word(&inaAverages[(configRegister&INA_CONFIG_AVG_MASK)>>9])*
+                      pgm_read_word(&inaConversionMicros[(configRegister&INA_SHUNT_TIME_MASK)>>3]);
+  float ratio  = noise/noiseMicroVolts;                                        // Noise falls with sqrt(time)
+  float needed = integration*ratio*ratio;                                      // Integration for the target
+  configRegister = tuneSetting(configRegister,acc->tunePeriod ? acc->tunePeriod : 0xFFFFFFFF,
+                               needed>=4.0e9 ? 4000000000UL : (uint32_t)needed+1);
+  if (configRegister!=unit.configRegister) {                                   // Change and measure again
+    writeConfig(configRegister,UNIT_ID);
+    resetStatistics(UNIT_ID);
+  }
+  return(getConversionMicros(UNIT_ID));                                        // return effective period
+} // END of method adaptTuning()
+
+/*******************************************************************************************************************
+** Method setSchedule duty-cycles a unit for battery powered use: the device is powered down now and from then on **
+** runSchedule() wakes it every intervalMillis for one triggered conversion with the channels of the current mode **
+** (both if none). An interval of 0 stops the schedule and leaves the device in its current mode. The state is    **
+** kept in the caller's INA226_Schedule, so units it has no entry for are left alone. Don't use other mode        **
+** changing calls on a scheduled unit.                                                                            **
+*******************************************************************************************************************/
+void INA226_Core::setSchedule(INA226_ScheduleSet &schedule,uint32_t intervalMillis,uint8_t UNIT_ID) {
+  inaSCHEDULE *entry = UNIT_ID<_unitCount ? schedule.unit(UNIT_ID) : NULL;     // NULL if nowhere to keep it
+  if (entry==NULL) return;
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Table entry, in range here
+  entry->intervalMillis = intervalMillis;
+  entry->state          = INA_SCHEDULE_SLEEPING;
+  if (!intervalMillis) return;                                                 // Schedule stopped
+  uint8_t channels = unit.configRegister&INA_TRIGGERED_BOTH;                   // Shunt and/or bus bits
+  if (channels)          entry->mode = channels;                               // Triggered version of the mode
+  else if (!entry->mode) entry->mode = INA_TRIGGERED_BOTH;                     // Powered down, measure both
+  writeConfig((unit.configRegister&~INA_CONFIG_MODE_MASK)|INA_POWER_DOWN,UNIT_ID);
+  entry->due = millis();                                                       // First sample straight away
+} // END of method setSchedule()
+
+/*******************************************************************************************************************
+** Method runSchedule is called from loop() and never blocks. A due unit is woken and triggered with one register **
+** write. Once poll() finds the conversion finished the unit is powered down again, before its results are read   **
+** as the registers keep their values, so the device is only active for the recovery and conversion time. The     **
+** readings are put in readings[UNIT_ID] and the number of units read is returned. A unit that has fallen more    **
+** than an interval behind skips the missed samples instead of catching up in a burst.                            **
+*******************************************************************************************************************/
+uint8_t INA226_Core::runSchedule(INA226_ScheduleSet &schedule,inaREADING readings[]) {
+  uint8_t completed = 0;                                                       // Readings returned
+  for (uint8_t UNIT_ID=0;UNIT_ID<_unitCount;UNIT_ID++) {
+    inaSTRUCT &unit = inaARRAY[UNIT_ID];                                       // In range, no check needed
+    inaSCHEDULE *entry = schedule.unit(UNIT_ID);                               // NULL if not in the schedule
+    if (!unit.address || !entry || !entry->intervalMillis) continue;           // Not scheduled
+    uint32_t transactions = _transactionCount;                                 // To count this unit's transfers
+    uint32_t bytes        = _byteCount;
+    bool     sampled      = false;                                             // Reading taken in this call
+    if (entry->state==INA_SCHEDULE_SLEEPING) {
+      if ((int32_t)(millis()-entry->due)<0) continue;                          // Not due yet
+      entry->due += entry->intervalMillis;                                     // Keep to the grid
+      if ((int32_t)(millis()-entry->due)>=0) entry->due = millis()+entry->intervalMillis;
+      entry->transactions = 0;
+      entry->bytes        = 0;
+      writeConfig((unit.configRegister&~INA_CONFIG_MODE_MASK)|entry->mode,UNIT_ID);// Wake and trigger
+      unit.conversionStart += INA_WAKE_MICROS;                                 // Conversion starts after recovery
+      unit.lastPoll         = unit.conversionStart;
+      entry->state          = INA_SCHEDULE_CONVERTING;
+    } else {
+      uint8_t status = poll(UNIT_ID);                                          // Finished yet?
+      if (status!=INA_POLL_PENDING) {                                          // Ready or timed out
+        writeConfig((unit.configRegister&~INA_CONFIG_MODE_MASK)|INA_POWER_DOWN,UNIT_ID);// Sleep, results kept
+        if (status==INA_POLL_READY) {
+          readings[UNIT_ID] = readAll(UNIT_ID);                                // Not triggered, so no restart
+          completed++;
+          sampled = true;
+        }
+        entry->state = INA_SCHEDULE_SLEEPING;
+      }
+    }
+    entry->transactions += _transactionCount-transactions;                     // This unit's share of the bus
+    entry->bytes        += _byteCount-bytes;
+    if (!sampled) continue;
+    inaSAMPLEENERGY &energy = entry->energy;                                   // Estimate the cost of the sample
+    inaBUS &bus  = _buses[unit.bus];
+    uint32_t clock = bus.highSpeedClock ? bus.highSpeedClock : bus.clock ? bus.clock : INA_I2C_STANDARD_CLOCK;
+    uint64_t bits  = 2*(uint32_t)entry->transactions+9*(uint32_t)entry->bytes; // START/STOP and bytes
+    uint64_t interval = (uint64_t)entry->intervalMillis*1000;                  // Microseconds between samples
+    energy.transactions = entry->transactions;
+    energy.bytes        = entry->bytes;
+    energy.busMicros    = (bits*1000000+clock-1)/clock;
+    energy.activeMicros = conversionMicros((unit.configRegister&~INA_CONFIG_MODE_MASK)|entry->mode)+
+                          INA_WAKE_MICROS;
+    uint64_t sleep = interval>energy.activeMicros ? interval-energy.activeMicros : 0;
+    energy.deviceNanoJoules = (uint64_t)INA_SUPPLY_MILLIVOLTS*                 // mV*nA*us is 1e-18 J
+                              ((uint64_t)INA_ACTIVE_NANOAMPS*energy.activeMicros+
+                               (uint64_t)INA_SHUTDOWN_NANOAMPS*sleep)/1000000000;
+    energy.busNanoJoules    = (uint64_t)INA_SUPPLY_MILLIVOLTS*INA_SUPPLY_MILLIVOLTS*// About one line pulled low
+                              energy.busMicros/(1000ULL*INA_PULLUP_OHMS);      // while SCL runs, mV^2/Ohm*us
+  }
+  return(completed);                                                           // return readings taken
+} // END of method runSchedule()
+
+
+/*******************************************************************************************************************
+** Method poll checks without blocking whether the current conversion has finished. No I2C traffic is generated   **
+** until the expected conversion time has passed, after that the conversion ready flag is read at most            **
+** INA_POLL_DIVISOR times per conversion time. Returns INA_POLL_READY (which also clears the flag and alert pin), **
+** INA_POLL_PENDING, or INA_POLL_TIMEOUT if nothing finished within INA_POLL_TIMEOUT_FACTOR conversion times or   **
+** the device is powered down.                                                                                    **
+*******************************************************************************************************************/
+uint8_t INA226_Core::poll(uint8_t UNIT_ID) {                                   // Non-blocking conversion check
+  uint32_t conversionTime = getConversionMicros(UNIT_ID);                      // Expected duration
+  uint32_t now = micros();                                                     // Current time
+  uint32_t elapsed = now - inaUnit(UNIT_ID).conversionStart;                   // Time since conversion start
+  uint32_t interval = conversionTime/INA_POLL_DIVISOR;                         // Minimum time between flag reads
+  if (interval<INA_POLL_MIN_INTERVAL) interval = INA_POLL_MIN_INTERVAL;
+  if (conversionTime==0) {                                                     // Power-down, nothing to wait for
+    inaUnit(UNIT_ID).pollStatus = INA_POLL_TIMEOUT;
+  } else if (elapsed<conversionTime ||                                         // Too early to look, or looked
+             now-inaUnit(UNIT_ID).lastPoll<interval) {                         // very recently
+    inaUnit(UNIT_ID).pollStatus = INA_POLL_PENDING;
+  } else {
+    inaUnit(UNIT_ID).lastPoll = now;                                           // Remember when we looked
+    uint16_t maskRegister = inaReadWord(INA_MASK_ENABLE_REG,inaUnit(UNIT_ID));
+    if (_TransmissionStatus==0 && (maskRegister&INA_CONV_RDY_MASK)) {          // Device answered and is ready
+      inaUnit(UNIT_ID).pollStatus = INA_POLL_READY;
+      inaUnit(UNIT_ID).conversionStart = now;                                  // Next continuous conversion
+    } else if (elapsed>=conversionTime*INA_POLL_TIMEOUT_FACTOR) {              // Took far too long
+      inaUnit(UNIT_ID).pollStatus = INA_POLL_TIMEOUT;
+      inaUnit(UNIT_ID).conversionStart = now;                                  // Start a new timeout window
+    } else {
+      inaUnit(UNIT_ID).pollStatus = INA_POLL_PENDING;
+    }
+  }
+  return(inaUnit(UNIT_ID).pollStatus);                                         // return the poll result
+} // END of method poll()
+
+/*******************************************************************************************************************
+** Method service polls every configured unit once, starting with the unit after the one last found ready so all  **
+** units are served fairly. It returns the UNIT_ID of the first unit with a finished conversion or INA_NO_UNIT.   **
+** Timeouts are available per unit through getPollStatus().                                                       **
+*******************************************************************************************************************/
+uint8_t INA226_Core::service() {                                               // Poll all units round-robin
+  for (uint8_t i=0;i<_unitCount;i++) {                                         // Visit every unit at most once
+    uint8_t unit = (_serviceUnit+i)%_unitCount;                                // Rotating start position
+    if (inaARRAY[unit].address==0) continue;                                   // Skip unused entries
+    if (poll(unit)==INA_POLL_READY) {                                          // Found a finished conversion
+      _serviceUnit = (unit+1)%_unitCount;                                      // Start after it next time
+      return(unit);
+    }
+  }
+  return(INA_NO_UNIT);                                                         // Nothing ready this time
+} // END of method service()
+
+/*******************************************************************************************************************
+** Method triggeredMode returns true if the unit's shadow mode is one of the three triggered modes                **
+*******************************************************************************************************************/
+bool INA226_Core::triggeredMode(uint8_t UNIT_ID) {                             // True if unit in a triggered mode
+  uint8_t mode = getOperatingMode(UNIT_ID);                                    // Mode bits of the shadow
+  return(!bitRead(mode,2) &&                                                   // Not continuous or power-down
+         (mode&B011)!=0);                                                      // and something to measure
+} // END of method triggeredMode
+
+/*******************************************************************************************************************
+** Method triggerAll starts a conversion on every configured unit that is in one of the triggered modes, one      **
+** write each from the shadow configuration register, so that all conversions run in parallel. Returns the        **
+** number of units triggered. Use collectAll() afterwards to read the results.                                    **
+*******************************************************************************************************************/
+uint8_t INA226_Core::triggerAll() {                                            // Start all triggered units at once
+  uint8_t triggered = 0;                                                       // Number of units started
+  for (uint8_t unit=0;unit<_unitCount;unit++) {                                // Loop through every unit
+    inaARRAY[unit].sweepPending = false;                                       // Assume not part of this sweep
+    if (inaARRAY[unit].address==0 || !triggeredMode(unit)) continue;           // Skip unused and continuous units
+    triggerConversion(unit);                                                   // Write shadow to start conversion
+    inaARRAY[unit].sweepPending = true;                                        // Needs collecting
+    triggered++;
+  }
+  return(triggered);                                                           // return units started
+} // END of method triggerAll()
+
+/*******************************************************************************************************************
+** Method collectAll waits for the units started by triggerAll() and reads each one with readAll() as soon as its **
+** conversion finishes, so results are gathered in completion order and the whole sweep takes about one           **
+** conversion time instead of one per unit. readAll() immediately retriggers each unit from its shadow register,  **
+** so calling collectAll() again collects the next, already running, sweep. readings[] is indexed by UNIT_ID and  **
+** must hold getUnitCount() entries. Returns the number of units collected, timed out units are left unchanged.   **
+*******************************************************************************************************************/
+uint8_t INA226_Core::collectAll(inaREADING readings[]) {                       // Gather results as they finish
+  uint8_t collected = 0;                                                       // Number of units read
+  uint8_t pending;                                                             // Units still converting
+  do {
+    pending = 0;
+    for (uint8_t unit=0;unit<_unitCount;unit++) {                              // Loop through every unit
+      if (!inaARRAY[unit].sweepPending) continue;                              // Not part of the sweep
+      uint8_t status = poll(unit);                                             // Rate limited ready check
+      if (status==INA_POLL_READY) {                                            // Finished, read it now
+        readings[unit] = readAll(unit);                                        // Also starts the next conversion
+        collected++;
+      } else if (status==INA_POLL_PENDING) {                                   // Still running
+        pending++;
+        continue;
+      }
+      inaARRAY[unit].sweepPending = false;                                     // Ready or timed out
+    }
+  } while (pending);                                                           // until every unit is done
+  for (uint8_t unit=0;unit<_unitCount;unit++)                                  // Retriggered units are part of
+    inaARRAY[unit].sweepPending = inaARRAY[unit].address!=0 &&                 // the next sweep
+                                  inaARRAY[unit].pollStatus==INA_POLL_READY && triggeredMode(unit);
+  return(collected);                                                           // return units read
+} // END of method collectAll()
+
+/*******************************************************************************************************************
+** Method acquire is the acquisition scheduler for racks spread over several buses. Each call visits every bus    **
+** once and reads at most one unit on it, the first unit after the one read last time on that bus whose           **
+** conversion has finished, so transfers alternate between the buses and no bus or unit is starved. It never      **
+** waits, readings[] is indexed by UNIT_ID and must hold getUnitCount() entries. Units in triggered mode have to  **
+** be started with triggerAll() first, readAll() then keeps them running. Returns the number of readings stored.  **
+*******************************************************************************************************************/
+uint8_t INA226_Core::acquire(inaREADING readings[]) {                          // Read one ready unit per bus
+  uint8_t stored = 0;                                                          // Number of units read
+  for (uint8_t busId=0;busId<_busCount;busId++) {                              // Interleave the buses
+    inaBUS &bus = _buses[busId];                                               // Bus table entry
+    for (uint8_t i=0;i<_unitCount;i++) {                                       // Round-robin on this bus
+      uint8_t unit = (bus.nextUnit+i)%_unitCount;
+      if (inaARRAY[unit].address==0 || inaARRAY[unit].bus!=busId) continue;    // Not on this bus
+      if (poll(unit)!=INA_POLL_READY) continue;                                // Still converting
+      readings[unit] = readAll(unit);                                          // Also starts the next conversion
+      bus.nextUnit = (unit+1)%_unitCount;                                      // Start after it next time
+      stored++;
+      break;                                                                   // One transfer per bus per call
+    }
+  }
+  return(stored);                                                              // return readings stored
+} // END of method acquire()
+
+/*******************************************************************************************************************
+** Method markAlert is meant to be called from the interrupt handler attached to a unit's ALERT pin. It does no   **
+** I2C traffic, it only pushes a timestamped marker for the unit into the alerts ring so readAlerts() can fetch   **
+** the data later. If the ring is full the marker is dropped and counted by the ring's overrun counter.           **
+*******************************************************************************************************************/
+void INA226_Core::markAlert(INA226_Ring &alerts,uint8_t UNIT_ID) {             // ISR safe, queue unit as ready
+  inaSAMPLE marker;                                                            // Registers are filled in later
+  marker.micros   = micros();                                                  // Time the conversion finished
+  marker.unit     = UNIT_ID;
+  marker.shuntRaw = 0;
+  marker.busRaw   = 0;
+  alerts.push(marker);                                                         // Counted as overrun if full
+} // END of method markAlert()
+
+/*******************************************************************************************************************
+** Method readAlerts is the deferred reader for markAlert(). Called from the main loop, it pops up to maxSamples  **
+** markers from the alerts ring, reads the shunt and bus registers of each marked unit into the marker, re-arms   **
+** the alert by reading the mask/enable register and retriggers units in triggered mode from the shadow register. **
+** Returns the number of samples completed in samples[], each timestamped when its alert fired.                   **
+*******************************************************************************************************************/
+uint8_t INA226_Core::readAlerts(INA226_Ring &alerts,inaSAMPLE samples[],uint8_t maxSamples) {
+  uint8_t count = alerts.pop(samples,maxSamples);                              // Markers queued by the ISR
+  for (uint8_t i=0;i<count;i++) {                                              // Complete each one
+    uint8_t unit = samples[i].unit;
+    samples[i].shuntRaw = inaReadWord(INA_SHUNT_VOLT_REG,inaUnit(unit));       // Get the raw shunt value
+    samples[i].busRaw   = inaReadWord(INA_BUS_VOLT_REG,inaUnit(unit));         // Get the raw bus value
+    inaReadWord(INA_MASK_ENABLE_REG,inaUnit(unit));                            // Clears flag and alert pin
+    if (triggeredMode(unit)) triggerConversion(unit);                          // Start the next conversion
+  }
+  return(count);                                                               // return samples completed
+} // END of method readAlerts()
+
+/*******************************************************************************************************************
+** Method setAccumulators gives the library the storage for the accumulators, see INA226_Accumulators. Until it   **
+** is called accumulate() does nothing and getStatistics() returns zeros. The set is cleared for a fresh start.   **
+*******************************************************************************************************************/
+void INA226_Core::setAccumulators(INA226_AccumulatorSet &accumulators) {       // Storage for the accumulators
+  _accumulators = &accumulators;                                               // Store the set
+  for (uint8_t unit=0;unit<_unitCount;unit++) {                                // and start every unit from zero
+    inaACCUMULATOR *acc = inaAccumulator(unit);
+    if (acc) memset(acc,0,sizeof(inaACCUMULATOR));
+  }
+} // END of method setAccumulators()
+
+/*******************************************************************************************************************
+** Method setAccumulating turns on or off feeding every readAll() result into the unit's accumulators. The        **
+** setting is kept in the accumulator, so it must have been provided with setAccumulators() first; without one    **
+** there is nothing to turn on.                                                                                   **
+*******************************************************************************************************************/
+void INA226_Core::setAccumulating(bool state,uint8_t UNIT_ID) {                // readAll() feeds accumulators
+  inaACCUMULATOR *acc = inaAccumulator(UNIT_ID);                               // NULL without accumulators
+  if (acc) acc->accumulating = state;                                          // Store the setting
+} // END of method setAccumulating()
+
+/*******************************************************************************************************************
+** Method accumulate adds one sample to the unit's accumulators. Energy and charge are integrated over the time   **
+** since the previous sample's timestamp, the reading being the average over that interval. The products are kept **
+** as a residue below one uWh/uAh so the whole units never lose precision and the 64 bit totals cannot overflow   **
+** in practice. Power takes the sign of the current so energy is net for batteries. Min, max, mean and variance   **
+** are kept as integer sums of the register values, see runningUpdate(); they cover the first                     **
+** INA_STATISTICS_MAX_SAMPLES samples of a window. Call from one context only, not from an ISR.                   **
+*******************************************************************************************************************/
+void INA226_Core::accumulate(const inaREADING &reading,uint32_t timestamp,uint8_t UNIT_ID) {
+  const int64_t microHour = 3600000000LL;                                      // Microseconds in an hour
+  inaACCUMULATOR *accumulator = inaAccumulator(UNIT_ID);                       // NULL without accumulators
+  if (!accumulator) return;                                                    // Nowhere to accumulate
+  inaACCUMULATOR &acc = *accumulator;
+  int32_t microWatts = reading.busMicroAmps<0 ? -reading.busMicroWatts : reading.busMicroWatts;
+  if (acc.started) {                                                           // Have a previous timestamp
+    uint32_t interval = timestamp-acc.lastMicros;                              // Wraps correctly
+    acc.elapsedMicros += interval;
+    acc.energyResidue += (int64_t)microWatts*interval;                         // uW*us
+    acc.chargeResidue += (int64_t)reading.busMicroAmps*interval;               // uA*us
+    if (acc.energyResidue>=microHour || acc.energyResidue<=-microHour) {       // Move whole uWh to the total
+      int64_t whole = acc.energyResidue/microHour;
+      acc.microWattHours += whole;
+      acc.energyResidue  -= whole*microHour;
+    }
+    if (acc.chargeResidue>=microHour || acc.chargeResidue<=-microHour) {       // Move whole uAh to the total
+      int64_t whole = acc.chargeResidue/microHour;
+      acc.microAmpHours += whole;
+      acc.chargeResidue -= whole*microHour;
+    }
+  }
+  acc.lastMicros = timestamp;                                                  // Start of the next interval
+  acc.started    = true;
+  if (acc.samples>=INA_STATISTICS_MAX_SAMPLES) return;                         // Counter full, integration goes on
+  acc.samples++;                                                               // One more sample
+  runningUpdate(acc.milliVolts,reading.busRaw,acc.samples);                    // Update the statistics
+  runningUpdate(acc.microAmps,reading.currentRaw,acc.samples);
+  runningUpdate(acc.microWatts,reading.currentRaw<0 ? -(int32_t)reading.powerRaw : reading.powerRaw,acc.samples);
+} // END of method accumulate()
+
+void INA226_Core::accumulate(const inaSAMPLE &sample) {                        // Add a ring sample
+  if (!inaAccumulator(sample.unit)) return;                                    // Don't scale it for nothing
+  inaREADING reading;                                                          // Scaled version of the sample
+  convertSamples(&sample,&reading,1);                                          // Scale it
+  accumulate(reading,sample.micros,sample.unit);                               // Use the conversion timestamp
+} // END of method accumulate()
+
+/*******************************************************************************************************************
+** Method getStatistics copies the unit's accumulators into a snapshot and optionally resets them in the same     **
+** call, so no sample can fall between the two. Integration continues from the last timestamp after a reset.      **
+*******************************************************************************************************************/
+void INA226_Core::getStatistics(inaSTATISTICS &statistics,bool resetAfter,uint8_t UNIT_ID) {
+  inaACCUMULATOR *accumulator = inaAccumulator(UNIT_ID);                       // NULL without accumulators
+  memset(&statistics,0,sizeof(statistics));                                    // Zeros if there is nothing
+  if (!accumulator) return;
+  inaACCUMULATOR &acc = *accumulator;
+  statistics.samples        = acc.samples;
+  statistics.elapsedMicros  = acc.elapsedMicros;
+  statistics.microWattHours = acc.microWattHours;
+  statistics.microAmpHours  = acc.microAmpHours;
+  runningResult(acc.milliVolts,statistics.busMilliVolts,acc.samples,INA_BUS_VOLT_LSB,100);// Scale like readAll()
+  runningResult(acc.microAmps,statistics.busMicroAmps,acc.samples,getCurrentLSB(UNIT_ID),1000);
+  runningResult(acc.microWatts,statistics.busMicroWatts,acc.samples,getPowerLSB(UNIT_ID),1000);
+  if (resetAfter) resetStatistics(UNIT_ID);                                    // Start a new window
+} // END of method getStatistics()
+
+/*******************************************************************************************************************
+** Method resetStatistics zeroes the accumulators but keeps the last timestamp so no interval is lost, and the    **
+** accumulating and tuneFor() settings                                                                            **
+*******************************************************************************************************************/
+void INA226_Core::resetStatistics(uint8_t UNIT_ID) {                           // Zero the accumulators
+  inaACCUMULATOR *accumulator = inaAccumulator(UNIT_ID);                       // NULL without accumulators
+  if (!accumulator) return;                                                    // Nothing to reset
+  inaACCUMULATOR &acc = *accumulator;
+  boolean  accumulating = acc.accumulating;                                    // Keep the settings
+  uint32_t tunePeriod   = acc.tunePeriod;
+  boolean  started      = acc.started;                                         // and the interval start
+  uint32_t lastMicros   = acc.lastMicros;
+  memset(&acc,0,sizeof(acc));                                                  // Zero everything
+  acc.accumulating = accumulating;
+  acc.tunePeriod   = tunePeriod;
+  acc.started      = started;
+  acc.lastMicros   = lastMicros;
+} // END of method resetStatistics()
+
+/*******************************************************************************************************************
+** Methods runningUpdate and runningResult keep min, max, mean and variance of a 16 bit register value as exact   **
+** integer sums of the differences to the first sample, so nothing is lost however long the window grows (a float **
+** mean stops moving once the step per sample falls below its resolution). A signed power value spans 17 bits, so **
+** a squared difference is just below 2^34 and the sum of squares wraps past 2^64 after 2^30 samples. That is     **
+** harmless: runningResult() only needs the squares less sum^2/samples, worked out modulo 2^64 as                 **
+** squares-samples*quotient^2-2*quotient*remainder less remainder^2/samples, and that is at most                  **
+** samples*(max-min)^2/4 < 2^64 for up to INA_STATISTICS_MAX_SAMPLES (2^32-1) samples, where accumulate() stops   **
+** counting. The sum of differences stays below 2^49. The results are scaled by multiplier/divisor, truncating    **
+** min and max like readAll().                                                                                    **
+*******************************************************************************************************************/
+void INA226_Core::runningUpdate(inaRUNNING &running,int32_t value,uint32_t samples) {
+  if (samples==1) {                                                            // First sample of the window
+    running.minimum  = value;
+    running.maximum  = value;
+    running.baseline = value;                                                  // keeps the differences small
+  }
+  if (value<running.minimum) running.minimum = value;                          // Track the extremes
+  if (value>running.maximum) running.maximum = value;
+  int32_t delta = value-running.baseline;                                      // At most 17 bits
+  running.sum     += delta;
+  running.squares += (uint64_t)((int64_t)delta*delta);                        // May wrap, see above
+} // END of method runningUpdate()
+
+void INA226_Core::runningResult(const inaRUNNING &running,inaSTATISTIC &statistic,uint32_t samples,
+                                uint32_t multiplier,uint32_t divisor) {
+  float scale = (float)multiplier/divisor;                                     // Units per register LSB
+  statistic.minimum  = (int64_t)running.minimum*multiplier/divisor;
+  statistic.maximum  = (int64_t)running.maximum*multiplier/divisor;
+  statistic.mean     = 0;
+  statistic.variance = 0;
+  if (samples==0) return;                                                      // Nothing accumulated
+  int64_t quotient  = running.sum/(int64_t)samples;                            // Whole part of the mean offset
+  int64_t remainder = running.sum%(int64_t)samples;                            // Same sign as the sum
+  statistic.mean = (running.baseline+quotient+(float)remainder/samples)*scale;
+  if (samples<2) return;                                                       // No spread from one sample
+  uint64_t whole = (uint64_t)(quotient<0 ? -quotient : quotient);              // |quotient| < 2^17
+  uint64_t part  = (uint64_t)(remainder<0 ? -remainder : remainder);           // Same sign as quotient
+  float m2 = (float)(running.squares-samples*whole*whole-2*whole*part)-        // Squares less sum^2/samples,
+             (float)part*part/samples;                                         // modulo 2^64
+  statistic.variance = (m2>0 ? m2 : 0)/(samples-1)*scale*scale;                // Sample variance
+} // END of method runningResult()
+
+/*******************************************************************************************************************
+** Method setTrips gives the library the storage for the trip state, see INA226_Trips. Until it is called         **
+** setTrip() does nothing. Every unit starts without a relay and not overloaded.                                  **
+*******************************************************************************************************************/
+void INA226_Core::setTrips(INA226_TripSet &trips) {                            // Storage for the trip state
+  _trips = &trips;                                                             // Store the set
+  for (uint8_t unit=0;unit<_unitCount;unit++) clearTripState(unit);            // and start every unit untripped
+} // END of method setTrips()
+
+/*******************************************************************************************************************
+** Method clearTripState puts the unit's trip state, if it has one, back to no relay and not overloaded           **
+*******************************************************************************************************************/
+void INA226_Core::clearTripState(uint8_t UNIT_ID) {                            // No relay, not overloaded
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  if (trip==NULL) return;
+  memset(trip,0,sizeof(inaTRIP));                                              // Zero everything
+  trip->relay = INA_NO_RELAY;                                                  // No relay until setTrip()
+} // END of method clearTripState()
+
+/*******************************************************************************************************************
+** Method setTrip programs the INA226 to watch for an overload by itself. The limit is converted to the register  **
+** value for the chosen function (INA_TRIP_CURRENT in mA using the shunt resistance, INA_TRIP_BUS_VOLTS in mV or  **
+** INA_TRIP_POWER in mW) and written to the Alert Limit register, then the function is enabled in the mask/enable **
+** register with the alert pin optionally latched. The device only allows one alert function at a time so this    **
+** replaces the alert on conversion ready. Attach tripAlert() to the ALERT pin interrupt; there is no I2C traffic **
+** at all until the limit is exceeded. Units without trip state from setTrips(), including out of range UNIT_ID   **
+** values, are left alone and the relay pin is not touched.                                                       **
+*******************************************************************************************************************/
+void INA226_Core::setTrip(uint32_t limit,uint16_t function,uint16_t relayPin,bool latch,uint8_t UNIT_ID) {
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  if (trip==NULL) return;                                                      // or for an out of range unit
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Table entry, in range here
+  trip->relay    = relayPin;                                                   // Store the settings
+  trip->overload = false;
+  if (trip->relay!=INA_NO_RELAY) {                                             // Put the relay in its on state
+    digitalWrite(trip->relay,!INA_RELAY_TRIPPED);
+    pinMode(trip->relay,OUTPUT);
+  }
+  unit.alertLimit = tripLimitRaw(limit,function,UNIT_ID);                      // Limit as a register value
+  inaWriteWord(INA_ALERT_LIMIT_REG,unit.alertLimit,unit);                      // Write the limit first
+  unit.maskRegister = (unit.maskRegister&~(INA_ALERT_FUNCTION_MASK|INA_ALERT_LATCH)) |
+                      function | (latch ? INA_ALERT_LATCH : 0);                // then enable the function
+  inaWriteWord(INA_MASK_ENABLE_REG,unit.maskRegister,unit);                    // Write register back to device
+} // END of method setTrip()
+
+/*******************************************************************************************************************
+** Method tripLimitRaw converts a limit in mA, mV or mW into the value the INA226 compares against                **
+*******************************************************************************************************************/
+uint16_t INA226_Core::tripLimitRaw(uint32_t limit,uint16_t function,uint8_t UNIT_ID) {
+  uint64_t raw;                                                                // Unlimited register value
+  if (function==INA_TRIP_POWER)                                                // Power register LSB in nW
+    raw = getPowerLSB(UNIT_ID) ? (uint64_t)limit*1000000/getPowerLSB(UNIT_ID) : 0xFFFF;
+  else if (function==INA_TRIP_BUS_VOLTS)                                       // Bus LSB is 1.25mV
+    raw = (uint64_t)limit*100/INA_BUS_VOLT_LSB;
+  else                                                                         // Shunt LSB is 2.5uV, mA*uOhm/1000
+    raw = (uint64_t)limit*inaUnit(UNIT_ID).microOhms/(INA_SHUNT_VOLT_LSB*100); // is the shunt voltage in uV
+  if (function==INA_TRIP_POWER) return(raw>0xFFFF ? 0xFFFF : raw);             // Power register is unsigned
+  return(raw>0x7FFF ? 0x7FFF : raw);                                           // Voltages are positive signed
+} // END of method tripLimitRaw()
+
+/*******************************************************************************************************************
+** Method tripAlert is meant to be called from the interrupt handler attached to a unit's ALERT pin when using    **
+** setTrip(). It drives the relay pin to INA_RELAY_TRIPPED, marks the unit as overloaded and records the time,    **
+** all without any I2C traffic. During a trip latency test only the time is recorded.                             **
+*******************************************************************************************************************/
+void INA226_Core::tripAlert(uint8_t UNIT_ID) {                                 // ISR safe, trip the relay
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  if (trip==NULL) return;
+  if (!trip->testing) {                                                        // A real overload
+    if (trip->relay!=INA_NO_RELAY)                                             // Open the relay first
+      digitalWrite(trip->relay,INA_RELAY_TRIPPED);
+    trip->overload = true;                                                     // then record the state
+  }
+  if (trip->tripMicros==0) trip->tripMicros = micros();                        // Keep the first trip time
+} // END of method tripAlert()
+
+/*******************************************************************************************************************
+** Method clearTrip reads the mask/enable register, which releases a latched alert pin, and then checks the       **
+** measurement being limited. If it is back below the limit the relay is switched on again and true is returned,  **
+** otherwise the unit stays tripped.                                                                              **
+*******************************************************************************************************************/
+bool INA226_Core::clearTrip(uint8_t UNIT_ID) {                                 // Reset relay if below the limit
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  if (trip==NULL) return false;
+  inaReadWord(INA_MASK_ENABLE_REG,inaUnit(UNIT_ID));                           // Release the latched alert pin
+  if (overLimit(UNIT_ID)) return false;                                        // Still overloaded
+  trip->overload   = false;                                                    // Clear the state
+  trip->tripMicros = 0;                                                        // Ready for the next trip time
+  if (trip->relay!=INA_NO_RELAY) digitalWrite(trip->relay,!INA_RELAY_TRIPPED); // Switch the relay back on
+  return true;
+} // END of method clearTrip()
+
+/*******************************************************************************************************************
+** Method overLimit reads the register the trip function in the mask/enable shadow watches and compares it with   **
+** the alert limit                                                                                                **
+*******************************************************************************************************************/
+bool INA226_Core::overLimit(uint8_t UNIT_ID) {                                 // Read and compare with the limit
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Bounds checked entry
+  uint16_t function = unit.maskRegister&INA_ALERT_FUNCTION_MASK;               // Function set by setTrip()
+  if (function==INA_TRIP_POWER)                                                // Power register is unsigned
+    return((uint16_t)inaReadWord(INA_POWER_REGISTER,unit)>unit.alertLimit);
+  uint8_t reg = function==INA_TRIP_BUS_VOLTS ? INA_BUS_VOLT_REG : INA_SHUNT_VOLT_REG;
+  return(inaReadWord(reg,unit)>(int16_t)unit.alertLimit);                      // Voltages are signed
+} // END of method overLimit()
+
+/*******************************************************************************************************************
+** Method isOverloaded returns whether tripAlert() has tripped the unit since the last clearTrip()                **
+*******************************************************************************************************************/
+bool INA226_Core::isOverloaded(uint8_t UNIT_ID) {                              // Retrieve overload state
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  return(trip ? trip->overload : false);                                       // return overload state
+} // END of method isOverloaded
+
+/*******************************************************************************************************************
+** Method startTripLatency starts a measurement of the complete protection path without switching the relay. It   **
+** briefly selects the shunt under-limit function with the highest possible limit, which every measurement        **
+** exceeds, and notes the time. pollTripLatency() then collects the result once the interrupt handler has called  **
+** tripAlert(). Returns false if the unit has no trip state.                                                      **
+*******************************************************************************************************************/
+bool INA226_Core::startTripLatency(uint8_t UNIT_ID) {                          // Arm the trip latency test
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  if (trip==NULL) return false;
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Table entry, in range here
+  trip->testing    = true;                                                     // Don't drive the relay
+  trip->tripMicros = 0;
+  inaWriteWord(INA_ALERT_LIMIT_REG,0x7FFF,unit);                               // Any shunt value is under this
+  inaWriteWord(INA_MASK_ENABLE_REG,(unit.maskRegister&~(INA_ALERT_FUNCTION_MASK|INA_ALERT_LATCH)) |
+               INA_TRIP_SHUNT_UNDER | INA_ALERT_LATCH,unit);                   // Latch so the pin stays active
+  trip->testStart = micros();                                                  // Limit is exceeded from now
+  return true;
+} // END of method startTripLatency()
+
+/*******************************************************************************************************************
+** Method pollTripLatency checks on a test started with startTripLatency() and returns INA_POLL_PENDING until     **
+** tripAlert() has run, with no I2C traffic while waiting. Then the latency is stored for getTripLatency(), the   **
+** original limit and function are restored and INA_POLL_READY is returned. The latency includes waiting for the  **
+** end of the running conversion, so it varies between zero and one conversion time plus interrupt latency. After **
+** INA_POLL_TIMEOUT_FACTOR conversion times without a trip the test is ended with a latency of 0 and              **
+** INA_POLL_TIMEOUT is returned, as it is for a unit without a test running.                                      **
+*******************************************************************************************************************/
+uint8_t INA226_Core::pollTripLatency(uint8_t UNIT_ID) {                        // Non-blocking latency test check
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  if (trip==NULL || !trip->testing) return(INA_POLL_TIMEOUT);                  // No test running
+  inaSTRUCT &unit = inaUnit(UNIT_ID);                                          // Table entry, in range here
+  uint32_t tripMicros = trip->tripMicros;                                      // Time written by tripAlert(),
+  bool tripped = tripMicros!=0 && tripMicros==trip->tripMicros;                // read twice as not atomic
+  if (!tripped && micros()-trip->testStart<getConversionMicros(UNIT_ID)*INA_POLL_TIMEOUT_FACTOR)
+    return(INA_POLL_PENDING);                                                  // Still waiting for the handler
+  trip->latency = tripped ? tripMicros-trip->testStart : 0;                    // Store the result
+  inaWriteWord(INA_ALERT_LIMIT_REG,unit.alertLimit,unit);                      // Restore the real limit
+  inaWriteWord(INA_MASK_ENABLE_REG,unit.maskRegister,unit);                    // and alert function
+  inaReadWord(INA_MASK_ENABLE_REG,unit);                                       // Release the latched alert pin
+  trip->tripMicros = 0;                                                        // Ready for the next trip time
+  trip->testing    = false;                                                    // Back to normal operation
+  return(tripped ? INA_POLL_READY : INA_POLL_TIMEOUT);                         // return test result
+} // END of method pollTripLatency()
+
+/*******************************************************************************************************************
+** Method getTripLatency returns the result of the last trip latency test without any I2C traffic                 **
+*******************************************************************************************************************/
+uint32_t INA226_Core::getTripLatency(uint8_t UNIT_ID) {                        // Retrieve last measured latency
+  inaTRIP *trip = inaTrip(UNIT_ID);                                            // NULL without trip state
+  return(trip ? trip->latency : 0);                                            // return trip latency
+} // END of method getTripLatency
+
+/*******************************************************************************************************************
+** Method getPollStatus returns the result of the last poll() for the unit without any I2C traffic                **
+*******************************************************************************************************************/
+uint8_t INA226_Core::getPollStatus(uint8_t UNIT_ID) {
+  return(inaUnit(UNIT_ID).pollStatus);                                         // return last poll result
+} // END of method getPollStatus
+
 /*******************************************************************************************************************
 ** Method setAlertPinOnConversion configure the INA226 to pull the ALERT pin low when a conversion is complete    **
 *******************************************************************************************************************/
-void INA226_Class::setAlertPinOnConversion(bool alertState,uint8_t UNIT_ID ) { // Enable pin change on conversion
-  uint16_t alertRegister;                                                      // Hold the alert register
-  alertRegister = inaReadWord(INA_MASK_ENABLE_REG,inaARRAY[UNIT_ID].address);  // Get the current register
-  if (!alertState) alertRegister &= ~((uint16_t)1<<10);                        // zero out the alert bit
-  else alertRegister |= (uint16_t)(1<<10);                                     // turn on the alert bit
-  inaWriteWord(INA_MASK_ENABLE_REG,alertRegister,inaARRAY[UNIT_ID].address);   // Write register back to device
+void INA226_Core::setAlertPinOnConversion(bool alertState,uint8_t UNIT_ID ) {  // Enable pin change on conversion
+  uint16_t alertRegister = inaUnit(UNIT_ID).maskRegister;                      // Start from the shadow register
+  if (!alertState) alertRegister &= ~INA_ALERT_CONV_READY;                     // zero out the alert bit
+  else alertRegister |= INA_ALERT_CONV_READY;                                  // turn on the alert bit
+  inaUnit(UNIT_ID).maskRegister = alertRegister;                               // Store the shadow value
+  inaWriteWord(INA_MASK_ENABLE_REG,alertRegister,inaUnit(UNIT_ID));            // Write register back to device
 } // END of method setAlertPinOnConversion
 
 /*******************************************************************************************************************
 ** Method reset resets the INA226 using the first bit in the configuration register                               **
 *******************************************************************************************************************/
-void INA226_Class::reset(uint8_t UNIT_ID) {                                    // Reset the INA226
-  inaWriteWord(INA_CONFIG_REG,0x8000,inaARRAY[UNIT_ID].address);               // Set most significant bit
+void INA226_Core::reset(uint8_t UNIT_ID) {                                     // Reset the INA226
+  inaWriteWord(INA_CONFIG_REG,0x8000,inaUnit(UNIT_ID));                        // Set most significant bit
   delayMicroseconds(I2C_RESET_DELAY);                                          // Let the INA226
+  inaUnit(UNIT_ID).configRegister = INA_DEFAULT_CONFIG;                        // Registers are back to defaults
+  inaUnit(UNIT_ID).maskRegister   = 0;
+  inaUnit(UNIT_ID).alertLimit     = 0;
+  inaUnit(UNIT_ID).conversionStart = micros();                                 // Reset started a conversion
+  inaWriteWord(INA_CALIBRATION_REG,inaUnit(UNIT_ID).calibration,               // Restore the calibration value
+               inaUnit(UNIT_ID));                                              // that the reset cleared
 } // END of method reset
+
+/*******************************************************************************************************************
+** INA226_Config builder methods. Each setter only changes the local copy of the configuration register, apply()  **
+** writes the result to the device and the shadow register with a single I2C transaction                          **
+*******************************************************************************************************************/
+INA226_Config::INA226_Config(INA226_Core &ina,uint8_t UNIT_ID,uint16_t configRegister) :
+  _ina(ina), _unit(UNIT_ID), _config(configRegister) {}                        // Start from the shadow value
+
+INA226_Config& INA226_Config::mode(uint8_t mode) {                             // Set the monitoring mode
+  _config &= ~INA_CONFIG_MODE_MASK;                                            // zero out the mode bits
+  _config |= mode & INA_CONFIG_MODE_MASK;                                      // shift in the mode settings
+  return *this;
+} // END of method mode()
+
+INA226_Config& INA226_Config::averaging(uint16_t averages) {                   // Set the number of averages taken
+  _config &= ~INA_CONFIG_AVG_MASK;                                             // zero out the averages part
+  _config |= (uint16_t)INA226_Core::averagingIndex(averages) << 9;             // shift in the averages to register
+  return *this;
+} // END of method averaging()
+
+INA226_Config& INA226_Config::busConversion(uint8_t convTime) {                // Set timing for Bus conversions
+  if (convTime>7) convTime=7;                                                  // Use maximum value allowed
+  _config &= ~INA_BUS_TIME_MASK;                                               // zero out the Bus conversion part
+  _config |= (uint16_t)convTime << 6;                                          // shift in the conversion time
+  return *this;
+} // END of method busConversion()
+
+INA226_Config& INA226_Config::shuntConversion(uint8_t convTime) {              // Set timing for Shunt conversions
+  if (convTime>7) convTime=7;                                                  // Use maximum value allowed
+  _config &= ~INA_SHUNT_TIME_MASK;                                             // zero out the Shunt conversion part
+  _config |= (uint16_t)convTime << 3;                                          // shift in the conversion time
+  return *this;
+} // END of method shuntConversion()
+
+void INA226_Config::apply() {                                                  // Write everything in one go
+  _ina.writeConfig(_config,_unit);                                             // Single write, shadow updated
+} // END of method apply()
+
+/*******************************************************************************************************************
+** INA226_AccumulatorSet methods                                                                                  **
+*******************************************************************************************************************/
+INA226_AccumulatorSet::INA226_AccumulatorSet(inaACCUMULATOR *units,uint8_t count) : // Class constructor
+  _units(units), _count(count) {}                                              // Storage from INA226_Accumulators
+
+inaACCUMULATOR* INA226_AccumulatorSet::unit(uint8_t UNIT_ID) {                 // NULL if UNIT_ID is out of range
+  return(UNIT_ID<_count ? &_units[UNIT_ID] : NULL);                            // return the unit's accumulators
+} // END of method unit()
+
+/*******************************************************************************************************************
+** INA226_TripSet methods                                                                                         **
+*******************************************************************************************************************/
+INA226_TripSet::INA226_TripSet(inaTRIP *units,uint8_t count) :                 // Class constructor
+  _units(units), _count(count) {}                                              // Storage from INA226_Trips
+
+inaTRIP* INA226_TripSet::unit(uint8_t UNIT_ID) {                               // NULL if UNIT_ID is out of range
+  return(UNIT_ID<_count ? &_units[UNIT_ID] : NULL);                            // return the unit's trip state
+} // END of method unit()
+
+/*******************************************************************************************************************
+** INA226_ScheduleSet methods                                                                                     **
+*******************************************************************************************************************/
+INA226_ScheduleSet::INA226_ScheduleSet(inaSCHEDULE *units,uint8_t count) :   // Class constructor
+  _units(units), _count(count) {}                                              // Storage from INA226_Schedule
+
+inaSCHEDULE* INA226_ScheduleSet::unit(uint8_t UNIT_ID) {                       // NULL if UNIT_ID is out of range
+  return(UNIT_ID<_count ? &_units[UNIT_ID] : NULL);                            // return the unit's schedule
+} // END of method unit()
+
+/*******************************************************************************************************************
+** Method getSampleEnergy returns the estimated cost of the last sample runSchedule() took from the unit, zeros   **
+** for a unit without an entry. Device energy covers a whole interval, the conversion at the typical quiescent    **
+** current and the rest of the interval at the typical power-down current, so it is the average supply power      **
+** times the interval. Bus energy is the current through the pull-ups while SCL runs at the bus clock, ignoring   **
+** the HS-mode master code.                                                                                       **
+*******************************************************************************************************************/
+inaSAMPLEENERGY INA226_ScheduleSet::getSampleEnergy(uint8_t UNIT_ID) {         // Cost of the last scheduled sample
+  inaSAMPLEENERGY energy = {};                                                 // Zeros without an entry
+  if (UNIT_ID<_count) energy = _units[UNIT_ID].energy;                         // Copy of the estimate
+  return(energy);                                                              // return the estimate
+} // END of method getSampleEnergy()
+
+/*******************************************************************************************************************
+** INA226_TelemetrySet methods                                                                                    **
+*******************************************************************************************************************/
+INA226_TelemetrySet::INA226_TelemetrySet(inaBUSHEALTH *units,uint16_t *latency,uint8_t count) :
+  _units(units), _latency(latency), _count(count) {}                           // Storage from INA226_Telemetry
+
+inaBUSHEALTH* INA226_TelemetrySet::unit(uint8_t UNIT_ID) {                     // Last entry if out of range
+  return(&_units[UNIT_ID<_count ? UNIT_ID : _count]);                          // return the unit's counters
+} // END of method unit()
+
+uint16_t* INA226_TelemetrySet::latency(uint8_t type) {                         // Histogram of an INA_LATENCY_ type
+  return(&_latency[type*INA_LATENCY_BUCKETS]);                                 // return first bucket
+} // END of method latency()
+
+void INA226_TelemetrySet::clear() {                                            // Zero all counters and histograms
+  memset(_units,0,sizeof(inaBUSHEALTH)*(_count+1));
+  memset(_latency,0,sizeof(uint16_t)*INA_LATENCY_TYPES*INA_LATENCY_BUCKETS);
+} // END of method clear()
+
+/*******************************************************************************************************************
+** INA226_Ring methods. The ring is safe for one producer and one consumer running in different contexts without  **
+** disabling interrupts: the producer only writes _head and the consumer only writes _tail, both are single byte  **
+** variables so reads and writes are atomic, and each index is only moved after the sample data is in place.      **
+*******************************************************************************************************************/
+INA226_Ring::INA226_Ring(inaSAMPLE *samples,uint8_t size) :                    // Class constructor
+  _samples(samples), _mask(size-1) {}                                          // Storage from INA226_SampleBuffer
+
+bool INA226_Ring::push(const inaSAMPLE &sample) {                              // Producer side, false if full
+  uint8_t head = _head;                                                        // Only we change the head
+  uint8_t next = (head+1)&_mask;                                               // Slot after this one
+  if (next==_tail) {                                                           // Buffer is full
+    _overruns++;                                                               // Count the lost sample
+    return false;
+  }
+  _samples[head] = sample;                                                     // Store the data first
+  INA_COMPILER_BARRIER();                                                      // Keep the store before the head
+  _head = next;                                                                // then publish it
+  return true;
+} // END of method push()
+
+uint8_t INA226_Ring::pop(inaSAMPLE samples[],uint8_t maxSamples) {             // Consumer side, batch removal
+  uint8_t tail  = _tail;                                                       // Only we change the tail
+  uint8_t head  = _head;                                                       // Snapshot of published samples
+  uint8_t count = 0;                                                           // Samples copied
+  INA_COMPILER_BARRIER();                                                      // No slot loads before the head
+  while (tail!=head && count<maxSamples) {                                     // Copy until empty or full
+    samples[count++] = _samples[tail];
+    tail = (tail+1)&_mask;
+  }
+  INA_COMPILER_BARRIER();                                                      // Keep the loads before the tail
+  _tail = tail;                                                                // Release the slots in one go
+  return(count);                                                               // return samples copied
+} // END of method pop()
+
+uint8_t INA226_Ring::available() {                                             // Samples waiting to be popped
+  return((_head-_tail)&_mask);                                                 // Distance from tail to head
+} // END of method available()
+
+uint32_t INA226_Ring::getOverruns() {                                          // Samples dropped as buffer full
+  uint32_t overruns;                                                           // Hold the counter
+  do overruns = _overruns; while (overruns!=_overruns);                        // Read until stable
+  return(overruns);                                                            // return overrun count
+} // END of method getOverruns()
+
+/*******************************************************************************************************************
+** INA226_Encoder methods. See the header file for the frame layout. A finished frame stays in the buffer and     **
+** data() stays valid until the next call to add() or header().                                                   **
+*******************************************************************************************************************/
+INA226_Encoder::INA226_Encoder(uint8_t *buffer,uint16_t size,inaDELTA *units,uint8_t unitCount) :
+  _buffer(buffer), _size(size), _units(units), _unitCount(unitCount) {}        // Storage from INA226_FrameBuffer
+
+uint16_t INA226_Encoder::crc16(const uint8_t data[],uint16_t length,uint16_t crc) {
+  while (length--) {                                                           // Polynomial 0x1021, MSB first
+    crc ^= (uint16_t)*data++<<8;
+    for (uint8_t bit=0;bit<8;bit++) crc = crc&0x8000 ? (crc<<1)^0x1021 : crc<<1;
+  }
+  return(crc);                                                                 // return updated CRC
+} // END of method crc16()
+
+uint8_t INA226_Encoder::putVarint(uint8_t *out,uint32_t value) {               // LEB128 encoding
+  uint8_t length = 0;                                                          // Bytes written
+  while (value>=0x80) {                                                        // 7 bits per byte, low bits first
+    out[length++] = (uint8_t)value|0x80;                                       // More bytes follow
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;                                              // Last byte
+  return(length);
+} // END of method putVarint()
+
+uint16_t INA226_Encoder::header(INA226_Core &ina,uint8_t UNIT_ID) {            // Build a unit metadata frame
+  if (_open || UNIT_ID>INA_FRAME_MAX_UNIT) return(0);                          // Finish the sample frame first
+  uint16_t calibration = ina.getCalibration(UNIT_ID);                          // Values the decoder needs
+  uint32_t currentLSB  = ina.getCurrentLSB(UNIT_ID);
+  uint32_t powerLSB    = ina.getPowerLSB(UNIT_ID);
+  _buffer[0]  = INA_FRAME_SYNC;
+  _buffer[1]  = INA_FRAME_HEADER;
+  _buffer[2]  = 14;                                                            // Payload length
+  _buffer[3]  = INA_FRAME_VERSION;
+  _buffer[4]  = UNIT_ID;
+  _buffer[5]  = ina.getAddress(UNIT_ID);
+  _buffer[6]  = ina.getBus(UNIT_ID);
+  _buffer[7]  = (uint8_t)calibration;       _buffer[8]  = (uint8_t)(calibration>>8);
+  _buffer[9]  = (uint8_t)currentLSB;        _buffer[10] = (uint8_t)(currentLSB>>8);
+  _buffer[11] = (uint8_t)(currentLSB>>16);  _buffer[12] = (uint8_t)(currentLSB>>24);
+  _buffer[13] = (uint8_t)powerLSB;          _buffer[14] = (uint8_t)(powerLSB>>8);
+  _buffer[15] = (uint8_t)(powerLSB>>16);    _buffer[16] = (uint8_t)(powerLSB>>24);
+  uint16_t crc = crc16(&_buffer[1],16);                                        // Type, length and payload
+  _buffer[17] = (uint8_t)crc;
+  _buffer[18] = (uint8_t)(crc>>8);
+  _length = 19;
+  return(_length);                                                             // return frame length
+} // END of method header()
+
+bool INA226_Encoder::add(const inaSAMPLE &sample) {                            // Append a record, false if full
+  if (sample.unit>INA_FRAME_MAX_UNIT) return(false);                           // Does not fit the tag byte
+  bool    start = !_open;                                                      // Record starts a new frame
+  bool    delta = !start && sample.unit<_unitCount && _units[sample.unit].seen;// Unit already in this frame
+  int32_t shunt = sample.shuntRaw;                                             // Values to send
+  int32_t bus   = sample.busRaw;
+  if (delta) {
+    shunt -= _units[sample.unit].shuntRaw;
+    bus   -= _units[sample.unit].busRaw;
+  }
+  int32_t step = start ? 0 : (int32_t)(sample.micros-_lastMicros);             // Alerts may arrive out of order
+  uint8_t record[16];                                                          // Longest record is 12 bytes
+  uint8_t length = 0;
+  record[length++] = sample.unit|(delta ? 0 : INA_FRAME_ABSOLUTE);             // Tag byte
+  length += putVarint(&record[length],((uint32_t)step<<1)^(uint32_t)(step>>31));// Zigzag keeps small values short
+  length += putVarint(&record[length],((uint32_t)shunt<<1)^(uint32_t)(shunt>>31));
+  length += putVarint(&record[length],((uint32_t)bus<<1)^(uint32_t)(bus>>31));
+  uint16_t used = start ? 8 : _length;                                         // Frame so far, header if new
+  if (used+length+2>_size || used-3+length>INA_FRAME_MAX_PAYLOAD) return(false);// No room, finish() first
+  if (start) {                                                                 // Only open a frame that has a record
+    _buffer[0] = INA_FRAME_SYNC;
+    _buffer[1] = INA_FRAME_SAMPLES;
+    _buffer[3] = _sequence;
+    _buffer[4] = (uint8_t)sample.micros;       _buffer[5] = (uint8_t)(sample.micros>>8);
+    _buffer[6] = (uint8_t)(sample.micros>>16); _buffer[7] = (uint8_t)(sample.micros>>24);
+    _length    = 8;
+    _records   = 0;
+    for (uint8_t unit=0;unit<_unitCount;unit++) _units[unit].seen = false;     // Deltas restart every frame
+    _open = true;
+  }
+  memcpy(&_buffer[_length],record,length);                                     // Append the record
+  _length += length;
+  _records++;
+  _lastMicros = sample.micros;
+  if (sample.unit<_unitCount) {                                                // Remember for the next delta
+    _units[sample.unit].shuntRaw = sample.shuntRaw;
+    _units[sample.unit].busRaw   = sample.busRaw;
+    _units[sample.unit].seen     = true;
+  }
+  return(true);
+} // END of method add()
+
+uint8_t INA226_Encoder::pending() {                                            // Records in the open frame
+  return(_open ? _records : 0);
+} // END of method pending()
+
+uint16_t INA226_Encoder::finish() {                                            // Close the frame, return length
+  if (!_open) return(0);                                                       // Nothing to send
+  _buffer[2] = _length-3;                                                      // Payload length
+  uint16_t crc = crc16(&_buffer[1],_length-1);                                 // Type, length and payload
+  _buffer[_length++] = (uint8_t)crc;
+  _buffer[_length++] = (uint8_t)(crc>>8);
+  _open = false;
+  _sequence++;                                                                 // Lets the decoder spot lost frames
+  return(_length);                                                             // return frame length
+} // END of method finish()
+
+const uint8_t* INA226_Encoder::data() {                                        // Finished frame to be sent
+  return(_buffer);
+} // END of method data()
@@ -26,8 +26,27 @@
 #define LIBRARY_VERSION  1.0.0
 
 #include "Arduino.h"
-#define WIRE_WRITE Wire.write
-#define WIRE_READ Wire.read
+
+/*****************************************************************************************************************
+** The I2C transport is chosen at compile time. It can be any class with the TwoWire methods begin(),           **
+** setClock(), beginTransmission(), write(), endTransmission(), requestFrom() and read(). By default the Arduino**
+** Wire library is used, the host build in extras/host replaces it with a simulated bus of INA226 devices.      **
+** Further instances of the same class, e.g. Wire1, are added with addBus() and each unit is bound to one bus.  **
+** HS mode needs a transport that can send the master code, take the expected NACK and keep the bus without a   **
+** STOP, then clock at up to 2.94MHz. The Arduino Wire cores send a STOP after a NACKed address (AVR twi.c) and **
+** most can't clock that fast, so HS support is only compiled in when INA_TRANSPORT_HIGH_SPEED is set to 1.     **
+** The transport header is included here instead of declaring the class, as some cores (ArduinoCore-mbed) make  **
+** TwoWire a typedef, which a class declaration would clash with.                                               **
+*****************************************************************************************************************/
+#ifndef INA_TRANSPORT                                                          // Allow the build to override
+  #define INA_TRANSPORT             TwoWire                                    // Class used to reach the bus
+  #define INA_TRANSPORT_HEADER      <Wire.h>                                   // Header declaring that class
+  #define INA_TRANSPORT_DEFAULT     Wire                                       // Instance used by default
+#endif
+#ifndef INA_TRANSPORT_HIGH_SPEED                                               // Allow the build to override
+  #define INA_TRANSPORT_HIGH_SPEED     0                                       // Transport can do HS mode
+#endif
+#include INA_TRANSPORT_HEADER                                                  // Declares the transport class
 
 /*****************************************************************************************************************
 ** Declare constants used in the class                                                                          **
@@ -35,7 +54,19 @@
 #define I2C_DELAY                     10                                       // Microsecond delay on write
 #define I2C_RESET_DELAY               28                                       // Microsecond delay for reset
 #define INA_DEFAULT                 0x40                                       // Default address if only 1
-#define INA_COUNT                      3                                       // Number of INA226s to monitor
+#ifndef INA_COUNT                                                              // Allow the sketch to override
+  #define INA_COUNT                    3                                       // Default units in INA226_Class
+#endif
+#define INA_SCAN_FIRST              0x40                                       // First address scan() probes
+#define INA_SCAN_LAST               0x4F                                       // Last address scan() probes
+#ifndef INA_MAX_BUSES                                                          // Allow the sketch to override
+  #define INA_MAX_BUSES                2                                       // I2C buses addBus() can hold
+#endif
+#define INA_NO_BUS                  0xFF                                       // addBus() table is full
+#define INA_I2C_STANDARD_CLOCK    100000                                       // Standard mode SCL in Hz
+#define INA_I2C_FAST_CLOCK        400000                                       // Fast mode, setClock() maximum
+#define INA_I2C_HS_CLOCK         2940000                                       // INA226 high-speed mode maximum
+#define INA_HS_MASTER_CODE          0x04                                       // Sent as 0x08, 00001XXX
 #define INA_CONFIG_REG                 0                                       // Registers common to all INAs
 #define INA_SHUNT_VOLT_REG             1                                       // Registers common to all INAs
 #define INA_BUS_VOLT_REG               2                                       // Registers common to all INAs
@@ -43,6 +74,11 @@
 #define INA_CURRENT_REGISTER           4                                       // Registers common to all INAs
 #define INA_CALIBRATION_REG            5                                       // Registers common to all INAs
 #define INA_MASK_ENABLE_REG            6                                       // Registers common to all INAs
+#define INA_ALERT_LIMIT_REG            7                                       // Registers common to all INAs
+#define INA_MANUFACTURER_ID_REG     0xFE                                       // "TI" on INA2xx devices
+#define INA_DIE_ID_REG              0xFF                                       // Device and revision
+#define INA_MANUFACTURER_ID       0x5449                                       // ASCII "TI"
+#define INA_DIE_ID                0x2260                                       // INA226, other INA2xx differ
 #define INA_RESET_DEVICE          0x8000                                       // Write to configuration to reset
 #define INA_DEFAULT_CONFIG        0x4127                                       // Default configuration register
 #define INA_BUS_VOLT_LSB             125                                       // LSB in uV *100 1.25mV
@@ -50,8 +86,21 @@
 #define INA_CONFIG_AVG_MASK       0x0E00                                       // Bits 9-11
 #define INA_BUS_TIME_MASK         0x01C0                                       // Bits 6-8
 #define INA_SHUNT_TIME_MASK       0x0038                                       // Bits 3-5
-#define INA_CONV_RDY_MASK         0x0080                                       // Bit 4
+#define INA_CONV_RDY_MASK         0x0008                                       // Bit 3, conversion ready flag
 #define INA_CONFIG_MODE_MASK      0x0007                                       // Bits 0-3
+#define INA_MASK_ENABLE_RW_MASK   0xFC03                                       // Writable bits 15-10, 1 and 0
+#define INA_ALERT_CONV_READY      0x0400                                       // Bit 10, alert on conversion
+#define INA_ALERT_FUNCTION_MASK   0xFC00                                       // Bits 15-10, alert functions
+#define INA_ALERT_LATCH           0x0001                                       // Bit 0, latch alert pin
+#define INA_ALERT_POLARITY        0x0002                                       // Bit 1, alert pin active high
+#define INA_TRIP_CURRENT          0x8000                                       // Shunt over-limit, limit in mA
+#define INA_TRIP_SHUNT_UNDER      0x4000                                       // Shunt under-limit, self test
+#define INA_TRIP_BUS_VOLTS        0x2000                                       // Bus over-limit, limit in mV
+#define INA_TRIP_POWER            0x0800                                       // Power over-limit, limit in mW
+#define INA_NO_RELAY              0xFFFF                                       // No relay pin configured
+#ifndef INA_RELAY_TRIPPED                                                      // Allow the sketch to override
+  #define INA_RELAY_TRIPPED         HIGH                                       // Relay pin level when tripped
+#endif
 #define INA_TRIGGERED_SHUNT         B001                                       // Triggered shunt, no bus
 #define INA_TRIGGERED_BUS           B010                                       // Triggered bus, no shunt
 #define INA_TRIGGERED_BOTH          B011                                       // Triggered bus and shunt
@@ -59,56 +108,524 @@
 #define INA_CONTINUOUS_SHUNT        B101                                       // Continuous shunt, no bus
 #define INA_CONTINUOUS_BUS          B110                                       // Continuous bus, no shunt
 #define INA_CONTINUOUS_BOTH         B111                                       // Both continuous, default value
+#define INA_POLL_PENDING               0                                       // Conversion still running
+#define INA_POLL_READY                 1                                       // Conversion finished, data valid
+#define INA_POLL_TIMEOUT               2                                       // No conversion within time limit
+#define INA_POLL_DIVISOR              16                                       // Poll 16 times per conversion
+#define INA_POLL_MIN_INTERVAL        100                                       // Minimum microseconds between polls
+#define INA_POLL_TIMEOUT_FACTOR        4                                       // Timeout after 4 conversion times
+#define INA_NO_UNIT                 0xFF                                       // No unit was ready in service()
+#define INA_TUNE_MIN_SAMPLES          16                                       // Samples adaptTuning() needs
+#define INA_STATISTICS_MAX_SAMPLES 0xFFFFFFFFUL                                // Statistics end when samples is full
+#define INA_FIXED_POINT_SHIFT         31                                       // Fraction bits of lsbFraction
+#ifndef INA_SUPPLY_MILLIVOLTS                                                  // Allow the sketch to override
+  #define INA_SUPPLY_MILLIVOLTS     3300                                       // VS and I2C pull-up supply
+#endif
+#ifndef INA_PULLUP_OHMS                                                        // Allow the sketch to override
+  #define INA_PULLUP_OHMS           4700                                       // SDA and SCL pull-up resistors
+#endif
+#define INA_ACTIVE_NANOAMPS       330000                                       // Quiescent current, typical
+#define INA_SHUTDOWN_NANOAMPS        500                                       // Power-down current, typical
+#define INA_WAKE_MICROS               40                                       // Recovery from power-down
+#define INA_SCHEDULE_SLEEPING          0                                       // Powered down until sample due
+#define INA_SCHEDULE_CONVERTING        1                                       // Triggered conversion running
+#define INA_FRAME_SYNC              0xA5                                       // First byte of every frame
+#define INA_FRAME_HEADER            0x01                                       // Frame type, unit metadata
+#define INA_FRAME_SAMPLES           0x02                                       // Frame type, raw sample records
+#define INA_FRAME_VERSION              1                                       // Stream format version
+#define INA_FRAME_OVERHEAD             5                                       // Sync, type, length and CRC
+#define INA_FRAME_MAX_PAYLOAD        255                                       // Length is a single byte
+#define INA_FRAME_ABSOLUTE          0x80                                       // Record values are not deltas
+#define INA_FRAME_MAX_UNIT          0x7F                                       // Units fit the record tag
+#define INA_I2C_RETRIES                2                                       // Default retries of a transfer
+#define INA_I2C_MAX_RETRIES            8                                       // Upper bound for setRetries()
+#define INA_I2C_BACKOFF               50                                       // Microseconds before 1st retry
+#define INA_I2C_MAX_BACKOFF        16383                                       // Longest delayMicroseconds() wait
+#define INA_I2C_NACK_ADDRESS           2                                       // endTransmission() return codes
+#define INA_I2C_NACK_DATA              3
+#define INA_I2C_OTHER_ERROR            4
+#define INA_I2C_TIMEOUT                5
+#define INA_I2C_SHORT_READ             6                                       // requestFrom() returned too few
+#define INA_LATENCY_READ               0                                       // Histogram of register reads
+#define INA_LATENCY_WRITE              1                                       // Histogram of register writes
+#define INA_LATENCY_PROBE              2                                       // Histogram of address probes
+#define INA_LATENCY_TYPES              3                                       // Number of histograms
+#define INA_LATENCY_BUCKETS           16                                       // Bucket n holds 2^n to 2^(n+1)-1us
 
 /*****************************************************************************************************************
 ** Declare structures used in the class                                                                         **
 *****************************************************************************************************************/
+typedef struct {                                                               // Running statistics of a register
+  int32_t  minimum;                                                            // Smallest value seen
+  int32_t  maximum;                                                            // Largest value seen
+  int32_t  baseline;                                                           // First value, sums are relative
+  int64_t  sum;                                                                // Sum of differences to baseline
+  uint64_t squares;                                                            // Sum of squared differences
+} inaRUNNING; // of structure
+
+typedef struct {                                                               // Per-unit accumulators
+  boolean  accumulating;                                                       // readAll() feeds the accumulators
+  uint32_t tunePeriod;                                                         // Longest period from tuneFor()
+  uint32_t samples;                                                            // Samples accumulated
+  boolean  started;                                                            // lastMicros holds a timestamp
+  uint32_t lastMicros;                                                         // Timestamp of previous sample
+  uint64_t elapsedMicros;                                                      // Integration time
+  int64_t  microWattHours;                                                     // Whole uWh integrated
+  int64_t  microAmpHours;                                                      // Whole uAh integrated
+  int64_t  energyResidue;                                                      // uW*us not yet a whole uWh
+  int64_t  chargeResidue;                                                      // uA*us not yet a whole uAh
+  inaRUNNING milliVolts;                                                       // Bus voltage statistics
+  inaRUNNING microAmps;                                                        // Current statistics
+  inaRUNNING microWatts;                                                       // Power statistics
+} inaACCUMULATOR; // of structure
+
+typedef struct {                                                               // Statistics of one value
+  int32_t minimum;                                                             // Smallest value seen
+  int32_t maximum;                                                             // Largest value seen
+  float   mean;                                                                // Mean value
+  float   variance;                                                            // Sample variance
+} inaSTATISTIC; // of structure
+
+typedef struct {                                                               // Snapshot of the accumulators
+  uint32_t samples;                                                            // Samples accumulated
+  uint64_t elapsedMicros;                                                      // Integration time
+  int64_t  microWattHours;                                                     // Net energy, signed with current
+  int64_t  microAmpHours;                                                      // Net charge
+  inaSTATISTIC busMilliVolts;                                                  // Bus voltage statistics
+  inaSTATISTIC busMicroAmps;                                                   // Current statistics
+  inaSTATISTIC busMicroWatts;                                                  // Power statistics
+} inaSTATISTICS; // of structure
+
+typedef struct {                                                               // I2C error counters of a unit
+  uint32_t transfers;                                                          // Register reads and writes
+  uint16_t nacks;                                                              // Address or data not acknowledged
+  uint16_t shortReads;                                                         // Fewer bytes than requested
+  uint16_t timeouts;                                                           // Transport reported a timeout
+  uint16_t busErrors;                                                          // Other transport errors
+  uint16_t retries;                                                            // Attempts repeated after an error
+  uint16_t failures;                                                           // Transfers given up after retries
+} inaBUSHEALTH; // of structure
+
+typedef struct {                                                               // Cost of one scheduled sample
+  uint32_t activeMicros;                                                       // Device powered up
+  uint32_t busMicros;                                                          // SCL running for the sample
+  uint16_t transactions;                                                       // I2C transactions for the sample
+  uint16_t bytes;                                                              // I2C bytes incl. address bytes
+  uint32_t deviceNanoJoules;                                                   // Supply energy over one interval
+  uint32_t busNanoJoules;                                                      // Energy lost in the pull-ups
+} inaSAMPLEENERGY; // of structure
+
+typedef struct {                                                               // Duty cycle of one unit
+  uint32_t intervalMillis;                                                     // setSchedule() interval, 0 = off
+  uint32_t due;                                                                // millis() of the next sample
+  uint8_t  mode;                                                               // Triggered mode of the schedule
+  uint8_t  state;                                                              // INA_SCHEDULE_ value
+  uint16_t transactions;                                                       // Transactions of the sample so far
+  uint16_t bytes;                                                              // Bytes of the sample so far
+  inaSAMPLEENERGY energy;                                                      // Cost of the last scheduled sample
+} inaSCHEDULE; // of structure
+
+typedef struct {                                                               // Trip state of one unit
+  uint16_t relay;                                                              // Relay pin, INA_NO_RELAY if none
+  volatile boolean overload;                                                   // Tripped since the last clearTrip()
+  volatile uint32_t tripMicros;                                                // micros() when tripAlert() ran
+  volatile boolean testing;                                                    // Latency test, don't drive relay
+  uint32_t testStart;                                                          // micros() the test limit was set
+  uint32_t latency;                                                            // Last measured trip latency
+} inaTRIP; // of structure
+
+typedef struct {                                                               // Values per I2C bus
+  INA_TRANSPORT *wire;                                                         // Transport instance for the bus
+  uint32_t clock;                                                              // SCL in Hz, 0 = transport default
+  uint32_t highSpeedClock;                                                     // HS-mode SCL in Hz, 0 = not used
+  boolean started;                                                             // begin() has been called
+  uint8_t nextUnit;                                                            // Unit acquire() looks at first
+} inaBUS; // of structure
+
 typedef struct {                                                               // Structure of values per device
   uint8_t address;                                                             // I2C Address of device
+  uint8_t bus;                                                                 // BUS_ID the device is on
   uint16_t calibration;                                                        // Calibration register value
-  uint32_t current_LSB;                                                        // Amperage LSB
-  uint32_t power_LSB;                                                          // Wattage LSB
-  uint8_t operatingMode;                                                       // Mode operation
-  uint16_t relay;                                                              // Relay pin for tripping on/off
-  uint32_t current;                                                            // maximum allowable current in mA
+  uint32_t lsbWhole;                                                           // uA per current LSB, whole part
+  uint32_t lsbFraction;                                                        // and fraction, power_LSB is 25x
   uint32_t microOhms;                                                          // microOhm value of shunt resistor
-  uint8_t OverloadmA;                                                          // mA maximum to trip relay  
-  boolean Overload;                                                            // In overload state True/False
+  uint32_t conversionStart;                                                    // micros() when conversion started
+  uint32_t lastPoll;                                                           // micros() of last ready flag read
+  uint16_t alertLimit;                                                         // Shadow of INA_ALERT_LIMIT_REG
+  uint16_t configRegister;                                                     // Shadow of INA_CONFIG_REG
+  uint16_t maskRegister;                                                       // Shadow of writable mask bits
+  uint8_t pollStatus;                                                          // Result of the last poll() call
+  boolean sweepPending;                                                        // Triggered, not yet collected
 } inaSTRUCT; // of structure
 
+typedef struct {                                                               // One full sample from a device
+  int16_t  shuntRaw;                                                           // Shunt voltage register contents
+  uint16_t busRaw;                                                             // Bus voltage register contents
+  int16_t  currentRaw;                                                         // Current register equivalent
+  uint16_t powerRaw;                                                           // Power register equivalent
+  int32_t  shuntMicroVolts;                                                    // Scaled shunt voltage in uV
+  uint32_t busMilliVolts;                                                      // Scaled bus voltage in mV
+  int32_t  busMicroAmps;                                                       // Scaled current in uA
+  int32_t  busMicroWatts;                                                      // Scaled power in uW
+} inaREADING; // of structure
+
+typedef struct {                                                               // Raw sample for the ring buffer
+  uint32_t micros;                                                             // Time the conversion finished
+  uint8_t  unit;                                                               // UNIT_ID the sample belongs to
+  int16_t  shuntRaw;                                                           // Shunt voltage register contents
+  uint16_t busRaw;                                                             // Bus voltage register contents
+} inaSAMPLE; // of structure
+
+typedef struct {                                                               // Last values of a unit in a frame
+  int16_t  shuntRaw;                                                           // Shunt register of last record
+  uint16_t busRaw;                                                             // Bus register of last record
+  boolean  seen;                                                               // Unit already in this frame
+} inaDELTA; // of structure
+
+/*****************************************************************************************************************
+** Declare class headers                                                                                        **
+*****************************************************************************************************************/
+/*****************************************************************************************************************
+** INA226_Ring passes raw samples from one producer to one consumer without disabling interrupts, so the        **
+** producer can be an interrupt handler: markAlert() pushes from the ALERT pin ISR and readAlerts() pops in     **
+** loop(). The indices are single bytes, and a compiler barrier keeps each slot access on its side of the index **
+** update that hands the slot over.                                                                             **
+*****************************************************************************************************************/
+class INA226_Ring {                                                            // Lock-free sample ring buffer
+  public:                                                                      // Publicly visible methods
+    INA226_Ring(inaSAMPLE *samples,uint8_t size);                              // Class constructor
+    bool push(const inaSAMPLE &sample);                                        // Producer side, false if full
+    uint8_t pop(inaSAMPLE samples[],uint8_t maxSamples);                       // Consumer side, batch removal
+    uint8_t available();                                                       // Samples waiting to be popped
+    uint32_t getOverruns();                                                    // Samples dropped as buffer full
+  private:                                                                     // Private variables
+    inaSAMPLE *_samples;                                                       // Storage from INA226_SampleBuffer
+    uint8_t _mask;                                                             // Size-1, size is a power of 2
+    volatile uint8_t _head = 0;                                                // Next write, only producer writes
+    volatile uint8_t _tail = 0;                                                // Next read, only consumer writes
+    volatile uint32_t _overruns = 0;                                           // Only producer writes
+}; // END of INA226_Ring definition
+
+/*****************************************************************************************************************
+** INA226_Accumulators holds the energy, charge and statistics accumulators of UNITS units. They are only       **
+** needed by sketches that integrate or keep statistics, so they are not part of the unit table: declare one    **
+** next to the INA226_Bank and pass it to setAccumulators(). Units without an accumulator ignore accumulate()   **
+** and get zero statistics.                                                                                     **
+*****************************************************************************************************************/
+class INA226_AccumulatorSet {                                                  // Accumulators of a range of units
+  public:                                                                      // Publicly visible methods
+    INA226_AccumulatorSet(inaACCUMULATOR *units,uint8_t count);                // Class constructor
+    inaACCUMULATOR* unit(uint8_t UNIT_ID);                                     // NULL if UNIT_ID is out of range
+  private:                                                                     // Private variables
+    inaACCUMULATOR *_units;                                                    // Storage from INA226_Accumulators
+    uint8_t _count;                                                            // Units with an accumulator
+}; // END of INA226_AccumulatorSet definition
+
+template<uint8_t UNITS = INA_COUNT> class INA226_Accumulators : public INA226_AccumulatorSet {
+  public:                                                                      // Publicly visible methods
+    INA226_Accumulators() : INA226_AccumulatorSet(_units,UNITS) {}             // Class constructor
+  private:                                                                     // Private variables
+    inaACCUMULATOR _units[UNITS] = {};                                         // Accumulator storage
+}; // END of INA226_Accumulators definition
+
+/*****************************************************************************************************************
+** INA226_Trips holds the relay and overload state that setTrip() and tripAlert() use for UNITS units. It is    **
+** only needed by sketches that protect a load, so it is not part of the unit table: declare one next to the    **
+** INA226_Bank and pass it to setTrips(). Units without an entry ignore setTrip() and are never overloaded.     **
+*****************************************************************************************************************/
+class INA226_TripSet {                                                         // Trip state of a range of units
+  public:                                                                      // Publicly visible methods
+    INA226_TripSet(inaTRIP *units,uint8_t count);                              // Class constructor
+    inaTRIP* unit(uint8_t UNIT_ID);                                            // NULL if UNIT_ID is out of range
+  private:                                                                     // Private variables
+    inaTRIP *_units;                                                           // Storage from INA226_Trips
+    uint8_t _count;                                                            // Units with trip state
+}; // END of INA226_TripSet definition
+
+template<uint8_t UNITS = INA_COUNT> class INA226_Trips : public INA226_TripSet {
+  public:                                                                      // Publicly visible methods
+    INA226_Trips() : INA226_TripSet(_units,UNITS) {}                           // Class constructor
+  private:                                                                     // Private variables
+    inaTRIP _units[UNITS] = {};                                                // Trip state storage
+}; // END of INA226_Trips definition
+
+/*****************************************************************************************************************
+** INA226_Telemetry holds the I2C error counters of UNITS units, one more set for traffic to addresses not in   **
+** the table, and the transfer latency histograms. It is only needed by sketches that monitor the bus, so it is **
+** not part of the unit table or the class: declare one next to the INA226_Bank and pass it to setTelemetry().  **
+** Until then nothing is counted and getBusHealth() and the latency calls return zeros.                         **
+*****************************************************************************************************************/
+class INA226_TelemetrySet {                                                    // Telemetry of a range of units
+  public:                                                                      // Publicly visible methods
+    INA226_TelemetrySet(inaBUSHEALTH *units,uint16_t *latency,uint8_t count);  // Class constructor
+    inaBUSHEALTH* unit(uint8_t UNIT_ID);                                       // Last entry if out of range
+    uint16_t* latency(uint8_t type);                                           // Histogram of an INA_LATENCY_ type
+    void clear();                                                              // Zero all counters and histograms
+  private:                                                                     // Private variables
+    inaBUSHEALTH *_units;                                                      // Storage from INA226_Telemetry
+    uint16_t *_latency;                                                        // INA_LATENCY_TYPES histograms
+    uint8_t _count;                                                            // Units with counters
+}; // END of INA226_TelemetrySet definition
+
+template<uint8_t UNITS = INA_COUNT> class INA226_Telemetry : public INA226_TelemetrySet {
+  public:                                                                      // Publicly visible methods
+    INA226_Telemetry() : INA226_TelemetrySet(_units,_latency[0],UNITS) {}      // Class constructor
+  private:                                                                     // Private variables
+    inaBUSHEALTH _units[UNITS+1] = {};                                         // Plus traffic to other addresses
+    uint16_t _latency[INA_LATENCY_TYPES][INA_LATENCY_BUCKETS] = {};            // Log2 bucketed transfer times
+}; // END of INA226_Telemetry definition
+
 /*****************************************************************************************************************
-** Declare class header                                                                                         **
+** INA226_Schedule holds the duty cycle of UNITS units for setSchedule() and runSchedule(). Only battery        **
+** powered sketches need one, so it is not part of the unit table: declare one next to the INA226_Bank and      **
+** pass it to both calls. getSampleEnergy() returns the cost of the last sample each unit took.                 **
 *****************************************************************************************************************/
-class INA226_Class {                                                           // Class definition
+class INA226_ScheduleSet {                                                     // Duty cycles of a range of units
   public:                                                                      // Publicly visible methods
-    INA226_Class();                                                            // Class constructor
-    ~INA226_Class();                                                           // Class destructor
+    INA226_ScheduleSet(inaSCHEDULE *units,uint8_t count);                      // Class constructor
+    inaSCHEDULE* unit(uint8_t UNIT_ID);                                        // NULL if UNIT_ID is out of range
+    inaSAMPLEENERGY getSampleEnergy(uint8_t UNIT_ID = 0);                      // Cost of the last scheduled sample
+  private:                                                                     // Private variables
+    inaSCHEDULE *_units;                                                       // Storage from INA226_Schedule
+    uint8_t _count;                                                            // Units with a schedule
+}; // END of INA226_ScheduleSet definition
+
+template<uint8_t UNITS = INA_COUNT> class INA226_Schedule : public INA226_ScheduleSet {
+  public:                                                                      // Publicly visible methods
+    INA226_Schedule() : INA226_ScheduleSet(_units,UNITS) {}                    // Class constructor
+  private:                                                                     // Private variables
+    inaSCHEDULE _units[UNITS] = {};                                            // Schedule storage
+}; // END of INA226_Schedule definition
+
+/*****************************************************************************************************************
+** INA226_SampleBuffer sizes the ring at compile time. SIZE must be a power of 2 no larger than 128, one entry  **
+** is always kept free to tell a full buffer from an empty one.                                                 **
+*****************************************************************************************************************/
+template<uint8_t SIZE> class INA226_SampleBuffer : public INA226_Ring {        // Class definition
+  static_assert(SIZE>=2 && SIZE<=128 && (SIZE&(SIZE-1))==0,"SIZE must be a power of 2 up to 128");
+  public:                                                                      // Publicly visible methods
+    INA226_SampleBuffer() : INA226_Ring(_buffer,SIZE) {}                       // Class constructor
+  private:                                                                     // Private variables
+    inaSAMPLE _buffer[SIZE];                                                   // Sample storage
+}; // END of INA226_SampleBuffer definition
+
+/*****************************************************************************************************************
+** INA226_Encoder packs raw samples into compact binary frames for streaming over a serial link. Each frame is  **
+** SYNC, type, payload length, payload and a CRC-16/CCITT (little endian) over type, length and payload. Header **
+** frames carry the version, UNIT_ID, address, BUS_ID, calibration, current_LSB and power_LSB of one unit.      **
+** Sample frames hold a sequence number and the micros() of the first record followed by one record per sample: **
+** a tag byte holding the UNIT_ID (INA_FRAME_ABSOLUTE set on the first record of the unit in the frame), then   **
+** the time since the previous record and the shunt and bus registers as zigzag varints. The registers are      **
+** deltas from the unit's previous record in the same frame, so a lost frame never corrupts the next one.       **
+** Multi-byte header fields are little endian. Use INA226_FrameBuffer to size the buffers.                      **
+*****************************************************************************************************************/
+class INA226_Core;                                                             // Forward declaration
+class INA226_Encoder {                                                         // Binary stream frame encoder
+  public:                                                                      // Publicly visible methods
+    INA226_Encoder(uint8_t *buffer,uint16_t size,inaDELTA *units,              // Class constructor
+                   uint8_t unitCount);
+    uint16_t header(INA226_Core &ina,uint8_t UNIT_ID);                         // Build a unit metadata frame
+    bool add(const inaSAMPLE &sample);                                         // Append a record, false if full
+    uint8_t pending();                                                         // Records in the open frame
+    uint16_t finish();                                                         // Close the frame, return length
+    const uint8_t* data();                                                     // Finished frame to be sent
+    static uint16_t crc16(const uint8_t data[],uint16_t length,                // CRC-16/CCITT-FALSE
+                          uint16_t crc = 0xFFFF);
+  private:                                                                     // Private variables and methods
+    uint8_t putVarint(uint8_t *out,uint32_t value);                            // LEB128 encoding, returns length
+    uint8_t *_buffer;                                                          // Storage from INA226_FrameBuffer
+    uint16_t _size;                                                            // Buffer size in bytes
+    inaDELTA *_units;                                                          // Delta state per unit
+    uint8_t _unitCount;                                                        // Units with delta state
+    uint16_t _length = 0;                                                      // Bytes in the buffer
+    uint8_t _records = 0;                                                      // Records in the open frame
+    boolean _open = false;                                                     // Sample frame being built
+    uint8_t _sequence = 0;                                                     // Next sample frame number
+    uint32_t _lastMicros = 0;                                                  // Time of the previous record
+}; // END of INA226_Encoder definition
+
+/*****************************************************************************************************************
+** INA226_FrameBuffer sizes the frame buffer and the per-unit delta state at compile time. Units at or above    **
+** UNITS are always sent as absolute values. SIZE must leave room for at least a few records.                   **
+*****************************************************************************************************************/
+template<uint16_t SIZE,uint8_t UNITS = INA_COUNT> class INA226_FrameBuffer : public INA226_Encoder {
+  static_assert(SIZE>=32 && SIZE<=INA_FRAME_MAX_PAYLOAD+INA_FRAME_OVERHEAD,"SIZE must be 32 to 260 bytes");
+  public:                                                                      // Publicly visible methods
+    INA226_FrameBuffer() : INA226_Encoder(_buffer,SIZE,_units,UNITS) {}        // Class constructor
+  private:                                                                     // Private variables
+    uint8_t _buffer[SIZE];                                                     // Frame storage
+    inaDELTA _units[UNITS];                                                    // Delta state per unit
+}; // END of INA226_FrameBuffer definition
+
+class INA226_Config {                                                          // Batched configuration builder
+  public:                                                                      // Publicly visible methods
+    INA226_Config(INA226_Core &ina,uint8_t UNIT_ID,uint16_t configRegister);   // Start from the shadow value
+    INA226_Config& mode(uint8_t mode);                                         // Set the monitoring mode
+    INA226_Config& averaging(uint16_t averages);                               // Set the number of averages taken
+    INA226_Config& busConversion(uint8_t convTime);                            // Set timing for Bus conversions
+    INA226_Config& shuntConversion(uint8_t convTime);                          // Set timing for Shunt conversions
+    void apply();                                                              // Write everything in one go
+  private:                                                                     // Private variables
+    INA226_Core &_ina;                                                         // Class instance to write through
+    uint8_t _unit;                                                             // INA226 Unit number
+    uint16_t _config;                                                          // Configuration being built
+}; // END of INA226_Config definition
+
+class INA226_Core {                                                            // Class definition
+  public:                                                                      // Publicly visible methods
+    INA226_Core(inaSTRUCT *units,uint8_t unitCount);                           // Class constructor
+    ~INA226_Core();                                                            // Class destructor
     void begin(uint32_t MAXmilliAmps = 819,                                   // Class initializer (ebay special)
                uint32_t SenseRes = 100000,                                     // Current Sense in microOhms
                uint8_t  UNIT_ID = 0,                                           // INA226 Unit number
-               uint8_t  I2C_ADDR = INA_DEFAULT);                               // INA226 I2C Address
+               uint8_t  I2C_ADDR = INA_DEFAULT,                                // INA226 I2C Address
+               uint8_t  BUS_ID = 0);                                           // Bus from addBus(), 0 is default
+    uint8_t scan(uint32_t MAXmilliAmps = 819,                                  // Find and set up all INA226s
+                 uint32_t SenseRes = 100000,                                   // Current Sense in microOhms
+                 uint8_t  BUS_ID = 0);                                         // Bus to scan
+    uint8_t getUnitCount();                                                    // Retrieve size of unit table
+    uint8_t addBus(INA_TRANSPORT &wire);                                       // Register another I2C bus
+    uint8_t getBusCount();                                                     // Number of registered buses
+    uint8_t getBus(uint8_t UNIT_ID = 0);                                       // Retrieve BUS_ID of a unit
+    void setClock(uint32_t clock,uint8_t BUS_ID = 0);                          // SCL frequency up to 400kHz
+    bool setHighSpeed(uint32_t clock,uint8_t BUS_ID = 0);                      // HS-mode SCL, 0 to turn off
+    uint8_t acquire(inaREADING readings[]);                                    // Read one ready unit per bus
     uint16_t getBusMilliVolts(bool waitSwitch = false,uint8_t UNIT_ID = 0);    // Retrieve Bus voltage in mV
     int16_t getShuntMicroVolts(bool waitSwitch = false,uint8_t UNIT_ID = 0);   // Retrieve Shunt voltage in uV
     int32_t getBusMicroAmps(uint8_t UNIT_ID = 0);                              // Retrieve micro-amps
     int32_t getBusMicroWatts(uint8_t UNIT_ID = 0);                             // Retrieve micro-watts
+    inaREADING readAll(uint8_t UNIT_ID = 0);                                   // Retrieve all values in one go
+    inaSAMPLE readRaw(uint8_t UNIT_ID = 0);                                    // Raw registers only, no scaling
+    static void convertShunt(const int16_t shuntRaw[],int32_t microVolts[],    // Batch scale shunt to uV
+                             uint16_t count);
+    static void convertBus(const uint16_t busRaw[],uint32_t milliVolts[],      // Batch scale bus to mV
+                           uint16_t count);
+    void convertCurrent(const int16_t shuntRaw[],int32_t microAmps[],          // Batch scale shunt to uA
+                        uint16_t count,uint8_t UNIT_ID = 0);
+    void convertPower(const int16_t shuntRaw[],const uint16_t busRaw[],        // Batch scale to uW
+                      int32_t microWatts[],uint16_t count,uint8_t UNIT_ID = 0);
+    void convertSamples(const inaSAMPLE samples[],inaREADING readings[],       // Scale mixed-unit ring samples
+                        uint16_t count);
+    uint32_t getTransactionCount();                                            // I2C transactions since reset
+    uint32_t getByteCount();                                                   // I2C bytes on the wire since reset
+    void resetBusCounters();                                                   // Zero the I2C bus counters
+    void setRetries(uint8_t retries,uint16_t backoffMicros = INA_I2C_BACKOFF); // Bounded retry of failed transfers
+    uint8_t getTransmissionStatus();                                           // Result of the last transfer
+    void setTelemetry(INA226_TelemetrySet &telemetry);                         // Storage for the bus telemetry
+    inaBUSHEALTH getBusHealth(uint8_t UNIT_ID = 0);                            // Retrieve I2C error counters
+    void resetBusHealth(uint8_t UNIT_ID = 0);                                  // Zero the I2C error counters
+    uint16_t getLatencyCount(uint8_t type,uint8_t bucket);                     // Transfers in a histogram bucket
+    uint32_t getLatencyPercentile(uint8_t type,uint8_t percent);               // Upper bound of percentile bucket
     uint8_t getAddress(uint8_t UNIT_ID = 0);                                   // Retrieve stored I2C Address
     uint16_t getCalibration(uint8_t UNIT_ID = 0);                              // Retrieve stored calibration
     uint32_t getCurrentLSB(uint8_t UNIT_ID = 0);                               // Retrieve stored current_LSB
     uint32_t getPowerLSB(uint8_t UNIT_ID = 0);                                 // Retrieve stored power_LSB
-    uint8_t getOperatingMode(uint8_t UNIT_ID = 0);                             // Retrieve stored operatingMode
+    uint8_t getOperatingMode(uint8_t UNIT_ID = 0);                             // Mode bits of shadow config
     void reset(uint8_t UNIT_ID = 0);                                           // Reset the device
     void setMode(uint8_t mode,uint8_t UNIT_ID = 0);                            // Set the monitoring mode
     void setAveraging(uint16_t averages,uint8_t UNIT_ID = 0);                  // Set the number of averages taken
     void setBusConversion(uint8_t convTime,uint8_t UNIT_ID = 0);               // Set timing for Bus conversions
     void setShuntConversion(uint8_t convTime,uint8_t UNIT_ID = 0);             // Set timing for Shunt conversions
-    void waitForConversion(uint8_t UNIT_ID = 0);                               // wait for conversion to complete
+    bool waitForConversion(uint8_t UNIT_ID = 0);                               // wait for conversion to complete
+    uint8_t poll(uint8_t UNIT_ID = 0);                                         // Non-blocking conversion check
+    uint8_t service();                                                         // Poll all units round-robin
+    uint8_t getPollStatus(uint8_t UNIT_ID = 0);                                // Retrieve result of last poll
+    void markAlert(INA226_Ring &alerts,uint8_t UNIT_ID = 0);                   // ISR safe, queue unit as ready
+    uint8_t readAlerts(INA226_Ring &alerts,inaSAMPLE samples[],                // Read the queued units
+                       uint8_t maxSamples);
+    void setAccumulators(INA226_AccumulatorSet &accumulators);                 // Storage for the accumulators
+    void setAccumulating(bool state,uint8_t UNIT_ID = 0);                      // readAll() feeds accumulators
+    void accumulate(const inaREADING &reading,uint32_t timestamp,              // Add a sample to accumulators
+                    uint8_t UNIT_ID = 0);
+    void accumulate(const inaSAMPLE &sample);                                  // Add a ring sample
+    void getStatistics(inaSTATISTICS &statistics,bool resetAfter = false,      // Snapshot, optionally reset
+                       uint8_t UNIT_ID = 0);
+    void resetStatistics(uint8_t UNIT_ID = 0);                                 // Zero the accumulators
+    void setTrips(INA226_TripSet &trips);                                      // Storage for the trip state
+    void setTrip(uint32_t limit,uint16_t function = INA_TRIP_CURRENT,          // Program hardware trip limit
+                 uint16_t relayPin = INA_NO_RELAY,bool latch = true,
+                 uint8_t UNIT_ID = 0);
+    void tripAlert(uint8_t UNIT_ID = 0);                                       // ISR safe, trip the relay
+    bool clearTrip(uint8_t UNIT_ID = 0);                                       // Reset relay if below the limit
+    bool isOverloaded(uint8_t UNIT_ID = 0);                                    // Retrieve overload state
+    bool startTripLatency(uint8_t UNIT_ID = 0);                                // Arm the trip latency test
+    uint8_t pollTripLatency(uint8_t UNIT_ID = 0);                              // Non-blocking latency test check
+    uint32_t getTripLatency(uint8_t UNIT_ID = 0);                              // Retrieve last measured latency
+    uint32_t getConversionMicros(uint8_t UNIT_ID = 0);                         // Expected time per conversion
+    uint32_t tuneFor(uint32_t targetHz,uint8_t UNIT_ID = 0);                   // Lowest noise meeting the rate
+    uint32_t adaptTuning(uint16_t noiseMicroVolts,uint8_t UNIT_ID = 0);        // Fastest meeting the noise target
+    void setSchedule(INA226_ScheduleSet &schedule,uint32_t intervalMillis,     // Duty cycle, power down between
+                     uint8_t UNIT_ID = 0);
+    uint8_t runSchedule(INA226_ScheduleSet &schedule,inaREADING readings[]);   // Start and collect due samples
+    uint8_t triggerAll();                                                      // Start all triggered units at once
+    uint8_t collectAll(inaREADING readings[]);                                 // Gather results as they finish
     void setAlertPinOnConversion(bool alertState,uint8_t UNIT_ID = 0);         // Enable pin change on conversion
+    INA226_Config configure(uint8_t UNIT_ID = 0);                              // Batch config changes, one write
+    uint16_t getConfiguration(uint8_t UNIT_ID = 0);                            // Retrieve shadow config register
+    void resyncRegisters(uint8_t UNIT_ID = 0);                                 // Reload shadows from the device
+    static uint8_t averagingIndex(uint16_t averages);                          // Convert averages to register code
   private:                                                                     // Private variables and methods
-    uint8_t inaReadByte(uint8_t regAddr,uint8_t I2C_ADDR);                     // Read a byte from an I2C address
-    int16_t inaReadWord(uint8_t regAddr,uint8_t I2C_ADDR);                     // Read a word from an I2C address
-    void inaWriteByte(uint8_t regAddr,uint8_t regData,uint8_t I2C_ADDR);       // Write a byte to an I2C address
-    void inaWriteWord(uint8_t regAddr,uint16_t regData,uint8_t I2C_ADDR);      // Write two bytes to an I2C address
+    void startWire(uint8_t BUS_ID);                                            // wire->begin() once per bus
+    void initUnit(uint8_t UNIT_ID,uint8_t I2C_ADDR,uint8_t BUS_ID,             // Store and calibrate a device
+                  uint32_t MAXmilliAmps,uint32_t SenseRes);
+    inaSTRUCT& inaUnit(uint8_t UNIT_ID);                                       // Bounds checked table entry
+    inaACCUMULATOR* inaAccumulator(uint8_t UNIT_ID);                           // NULL if the unit has none
+    inaTRIP* inaTrip(uint8_t UNIT_ID);                                         // NULL if the unit has none
+    void clearTripState(uint8_t UNIT_ID);                                      // No relay, not overloaded
+    inaSTRUCT& inaCandidate(uint8_t I2C_ADDR,uint8_t BUS_ID);                  // Spare entry for begin() and scan()
+    bool inaProbe(inaSTRUCT &unit);                                            // Check for an acknowledge
+    bool inaIdentify(inaSTRUCT &unit);                                         // Check the ID registers
+    void enterHighSpeed(inaBUS &bus);                                          // Master code, switch to HS clock
+    void leaveHighSpeed(inaBUS &bus);                                          // Back to the normal clock
+    uint16_t tripLimitRaw(uint32_t limit,uint16_t function,uint8_t UNIT_ID);   // Convert limit to register value
+    bool overLimit(uint8_t UNIT_ID);                                           // Read and compare with the limit
+    static void runningUpdate(inaRUNNING &running,int32_t value,uint32_t samples);// Integer sums update
+    static void runningResult(const inaRUNNING &running,inaSTATISTIC &statistic,uint32_t samples,
+                              uint32_t multiplier,uint32_t divisor);           // Scaled min, max, mean, variance
+    static uint32_t fixedPoint(uint32_t nanoLSB);                              // Fraction of LSB/1000
+    static uint32_t conversionMicros(uint16_t configRegister);                 // Time per conversion of a setting
+    static uint16_t tuneSetting(uint16_t configRegister,uint32_t maxPeriod,    // Pick averaging and conversion
+                                uint32_t minIntegration);
+    friend class INA226_Config;                                                // Builder writes through writeConfig
+    void writeConfig(uint16_t configRegister,uint8_t UNIT_ID);                 // Write and shadow config register
+    void triggerConversion(uint8_t UNIT_ID);                                   // Start next triggered conversion
+    bool triggeredMode(uint8_t UNIT_ID);                                       // True if unit in a triggered mode
+    bool inaRead(uint8_t regAddr,uint8_t data[],uint8_t length,                // Read with retries and telemetry
+                 inaSTRUCT &unit);
+    bool inaWrite(uint8_t regAddr,const uint8_t data[],uint8_t length,         // Write with retries and telemetry
+                  inaSTRUCT &unit);
+    inaBUSHEALTH* inaHealth(inaSTRUCT &unit);                                  // NULL without telemetry
+    bool retryTransfer(uint8_t attempt,inaBUSHEALTH *health);                  // Count error, back off if retrying
+    void recordLatency(uint8_t type,uint32_t microSeconds);                    // Add to a latency histogram
+    uint8_t inaReadByte(uint8_t regAddr,inaSTRUCT &unit);                      // Read a byte from a device
+    int16_t inaReadWord(uint8_t regAddr,inaSTRUCT &unit);                      // Read a word from a device
+    void inaWriteByte(uint8_t regAddr,uint8_t regData,inaSTRUCT &unit);        // Write a byte to a device
+    void inaWriteWord(uint8_t regAddr,uint16_t regData,inaSTRUCT &unit);       // Write two bytes to a device
     uint8_t _TransmissionStatus = 0;                                           // Return code for I2C transmission
-    inaSTRUCT inaARRAY[INA_COUNT];                                             // Build array to hold struct
-}; // END of INA226_Class definition
+    inaBUS _buses[INA_MAX_BUSES] = {};                                         // I2C buses, 0 is the default
+    uint8_t _busCount = 1;                                                     // Buses registered
+    uint32_t _transactionCount = 0;                                            // I2C transactions performed
+    uint32_t _byteCount = 0;                                                   // I2C bytes incl. address bytes
+    uint8_t _retries = INA_I2C_RETRIES;                                        // Retries after a failed transfer
+    uint16_t _backoff = INA_I2C_BACKOFF;                                       // First retry delay, then doubled
+    inaSTRUCT *inaARRAY;                                                       // Table of units plus a spare
+    uint8_t _unitCount;                                                        // Number of usable units
+    uint8_t _serviceUnit = 0;                                                  // Next unit service() polls first
+    INA226_AccumulatorSet *_accumulators = NULL;                               // From setAccumulators(), optional
+    INA226_TripSet *_trips = NULL;                                             // From setTrips(), optional
+    INA226_TelemetrySet *_telemetry = NULL;                                    // From setTelemetry(), optional
+}; // END of INA226_Core definition
+
+/*****************************************************************************************************************
+** INA226_Bank sizes the unit table at compile time so small boards only use RAM for the devices they have. The **
+** extra entry at the end is a spare which out of range UNIT_ID values are directed to. INA226_Class keeps the  **
+** original name and INA_COUNT units, e.g. "INA226_Bank<16> INA226;" declares a 16 device rack instead.         **
+*****************************************************************************************************************/
+template<uint8_t UNITS = INA_COUNT> class INA226_Bank : public INA226_Core {   // Class definition
+  public:                                                                      // Publicly visible methods
+    INA226_Bank() : INA226_Core(_units,UNITS) {}                               // Class constructor
+  private:                                                                     // Private variables
+    inaSTRUCT _units[UNITS+1];                                                 // Units plus a spare entry
+}; // END of INA226_Bank definition
+typedef INA226_Bank<> INA226_Class;                                            // Original class name
 #endif // END DBOE_INA226_h
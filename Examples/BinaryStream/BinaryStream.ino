@@ -0,0 +1,63 @@
+﻿/*******************************************************************************************************************
+** Program to demonstrate the binary streaming of INA226 samples. The raw shunt and bus registers of every        **
+** conversion are packed into compact frames by INA226_FrameBuffer and written to the serial port, which needs    **
+** far less bandwidth and processor time than printing text. A header frame with the calibration of each unit is  **
+** sent every few seconds so a capture can be decoded from any point.                                             **
+**                                                                                                                **
+** Capture the output on the host, e.g. "cat /dev/ttyACM0 > capture.bin", and convert it to CSV with the decoder  **
+** in extras/host: "make -C extras/host decode" and "extras/host/decode capture.bin > capture.csv".               **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#include <DBOE_INA226.h>
+
+// Declare global variables and instantiate classes
+INA226_Class INA226;                                                           // INA class instantiation
+INA226_FrameBuffer<64> frames;                                                 // Encoder with a 64 byte frame
+uint8_t  devicesFound  = 0;                                                    // Units found by scan()
+uint32_t lastHeader    = 0;                                                    // millis() of the last headers
+#define HEADER_INTERVAL 5000                                                   // Milliseconds between headers
+
+void sendHeaders() {
+  for (uint8_t unit=0;unit<devicesFound;unit++)                                // Metadata of every unit
+    Serial.write(frames.data(),frames.header(INA226,unit));
+  lastHeader = millis();
+} // of method sendHeaders()
+
+void setup() {
+  Serial.begin(115200);                                                        // Start serial communications
+
+  #ifdef  __AVR_ATmega32U4__                                                   // If we are a 32U4 processor,
+    delay(2000);                                                               // then wait 2 seconds for serial
+  #endif                                                                       // interface to initialize
+
+  devicesFound = INA226.scan(819,100000);                                      // 819mA max, 0.1 Ohm shunt
+  for (uint8_t unit=0;unit<devicesFound;unit++)
+    INA226.configure(unit)                                                     // Settings written in one go
+          .averaging(1)                                                        // No averaging
+          .busConversion(4)                                                    // Conversion time 1.1ms
+          .shuntConversion(4)                                                  // Conversion time 1.1ms
+          .mode(INA_CONTINUOUS_BOTH)                                           // Bus/shunt measured continuously
+          .apply();
+  sendHeaders();
+}
+
+void loop() {
+  if (millis()-lastHeader>=HEADER_INTERVAL) {                                  // Time to repeat the metadata
+    if (frames.pending()) Serial.write(frames.data(),frames.finish());         // Close the open frame first
+    sendHeaders();
+  }
+  for (uint8_t unit=0;unit<devicesFound;unit++) {
+    if (INA226.poll(unit)!=INA_POLL_READY) continue;                           // No new conversion yet
+    inaSAMPLE sample = INA226.readRaw(unit);                                   // Two register reads, no maths
+    if (!frames.add(sample)) {                                                 // Frame full, send it
+      Serial.write(frames.data(),frames.finish());
+      frames.add(sample);                                                      // First record of the next frame
+    }
+  }
+}
@@ -0,0 +1,54 @@
+﻿/*******************************************************************************************************************
+** Program to demonstrate duty-cycled sampling for battery or solar powered nodes. The INA226 is powered down     **
+** between samples and woken once a minute for a single triggered conversion, which takes its supply current      **
+** from about 330uA in continuous mode to a little over 1uA on average. The estimated device and I2C bus energy   **
+** of each sample is printed with the reading.                                                                    **
+**                                                                                                                **
+** This example is for a INA226 set up to measure a 819mA load with a 0.1 Ohm resistor in place, this is the same **
+** setup that can be found in the ebay INA226 breakout boards.                                                    **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#include <DBOE_INA226.h>
+
+// Declare global variables and instantiate classes
+INA226_Class INA226;                                                           // INA class instantiation
+INA226_Schedule<> schedule;                                                    // Duty cycle of each unit
+inaREADING   readings[INA_COUNT];                                              // Filled by runSchedule()
+#define INA1 0x40                                                              // INA226 I2C Address
+#define SAMPLE_INTERVAL 60000                                                  // One reading a minute
+
+void setup() {
+  Serial.begin(115200);                                                        // Start serial communications
+
+  #ifdef  __AVR_ATmega32U4__                                                   // If we are a 32U4 processor,
+    delay(2000);                                                               // then wait 2 seconds for serial
+  #endif                                                                       // interface to initialize
+
+  INA226.begin(819,100000, 0, INA1);                                           // 819mA max, 0.1 Ohm shunt
+  INA226.configure()                                                           // Settings written in one go
+        .averaging(64)                                                         // One well averaged reading
+        .busConversion(4)                                                      // Conversion time 1.1ms
+        .shuntConversion(4)                                                    // Conversion time 1.1ms
+        .mode(INA_TRIGGERED_BOTH)                                              // Bus and shunt when triggered
+        .apply();
+  INA226.setSchedule(schedule,SAMPLE_INTERVAL);                                // Power down, sample each minute
+}
+
+void loop() {
+  if (INA226.runSchedule(schedule,readings)==0) return;                        // Nothing finished, never blocks
+  inaSAMPLEENERGY energy = schedule.getSampleEnergy();                         // Estimated cost of the sample
+  Serial.print("Bus Volts: ");
+  Serial.print((float)readings[0].busMilliVolts/1000.0,4);                     // Convert to volts
+  Serial.print("V Bus Amps: ");
+  Serial.print((float)readings[0].busMicroAmps/1000.0,3);                      // Convert to milliamp
+  Serial.print("mA Device uJ: ");
+  Serial.print((float)energy.deviceNanoJoules/1000.0,2);                       // Supply energy per interval
+  Serial.print(" Bus uJ: ");
+  Serial.println((float)energy.busNanoJoules/1000.0,3);                        // Pull-up energy per sample
+}
@@ -21,7 +21,7 @@
 ** If you would like an EEPROM based version see his Github at https://github.com/SV-Zanshin/INA226               **
 ** This version holds everything in a structure array as EEPROM memory is usually limited and slower to update    **
 *******************************************************************************************************************/
-#include <DBOE INA226.h>
+#include <DBOE_INA226.h>
 
 #define INA226_ALERT_PIN 8                                                     // Pin 8. Micro only allows SS,SCK
 #define GREEN_LED_PIN 13                                                       // Green LED
@@ -30,24 +30,16 @@
 
 //Declare global variables and instantiate classes
 INA226_Class INA226;                                                           // INA class instantiation
-volatile uint64_t sumBusMillVolts =      0;                                    // Sum of bus voltage readings
-volatile int64_t  sumBusMicroAmps =      0;                                    // Sum of bus amperage readings
-volatile uint8_t  readings        =      0;                                    // Number of measurements taken
+INA226_SampleBuffer<16> alerts;                                                // Alerts queued by the ISR
+INA226_Accumulators<>   accumulators;                                          // Energy and statistics storage
 
-//Declare interrupt service routine for the pin-change interrupt on pin 8 which is set in the setup() method
+//Declare interrupt service routine for the pin-change interrupt on pin 8 which is set in the setup() method. The
+//handler only queues the unit in the ring, the I2C reads are done later from loop() so interrupts never need to be
+//re-enabled
 ISR (PCINT0_vect) {
+  if (digitalRead(INA226_ALERT_PIN)) return;                                   // Only act on the falling edge
   digitalWrite(GREEN_LED_PIN,!digitalRead(GREEN_LED_PIN));                     // Toggle LED to show we are working
-  *digitalPinToPCMSK(INA226_ALERT_PIN)&=~bit(digitalPinToPCMSKbit(INA226_ALERT_PIN)); // Disable PCMSK pin
-  PCICR &= ~bit(digitalPinToPCICRbit(INA226_ALERT_PIN));                       // disable interrupt for the group
-  sei();                                                                       // Enable interrupts for I2C calls
-  sumBusMillVolts += INA226.getBusMilliVolts(INA1);                            // Read the current value
-  sumBusMicroAmps += INA226.getBusMicroAmps(INA1);                             // Read the current value
-  readings++;                                                                  // Increment the number of readings
-  INA226.waitForConversion(INA1);                                              // Resets INA226 interrupt flag
-  cli();                                                                       // Disable interrupts
-  *digitalPinToPCMSK(INA226_ALERT_PIN)|=bit(digitalPinToPCMSKbit(INA226_ALERT_PIN)); // Enable PCMSK pin
-  PCIFR  |= bit (digitalPinToPCICRbit(INA226_ALERT_PIN));                      // clear any outstanding interrupt
-  PCICR  |= bit (digitalPinToPCICRbit(INA226_ALERT_PIN));                      // enable interrupt for the group
+  INA226.markAlert(alerts,0);                                                  // Queue unit 0 as ready
 }
 
 void setup() {
@@ -68,34 +60,44 @@ void setup() {
   // The begin initializes with expected 819 mA maximum current and for a 0.1 Ohm (100000 microOhm) resistor,
   // 1 device connected, I2C address of 0x40 (INA1). This assumes a ebay special INA226 board
   INA226.begin(819,100000,0,INA1);
-  INA226.setAveraging(64);                                                     // Average each reading n-times
-  INA226.setBusConversion(4);                                                  // Maximum conversion time 1.1ms
-  INA226.setShuntConversion(4);                                                // Maximum conversion time 1.1ms
-  INA226.setMode(INA_MODE_CONTINUOUS_BOTH);                                    // Bus/shunt measured continuously
+  INA226.setAccumulators(accumulators);                                        // Needed for getStatistics()
+  INA226.configure()                                                           // Settings written in one go
+        .averaging(64)                                                         // Average each reading n-times
+        .busConversion(4)                                                      // Maximum conversion time 1.1ms
+        .shuntConversion(4)                                                    // Maximum conversion time 1.1ms
+        .mode(INA_CONTINUOUS_BOTH)                                             // Bus/shunt measured continuously
+        .apply();
   INA226.setAlertPinOnConversion(true);                                        // Make alert pin go low on finish
 }
 
 void loop() {
   static long lastMillis = millis();                                           // Store the last time we printed
+  inaSAMPLE   batch[8];                                                        // Samples read for the alerts
+  inaSTATISTICS stats;                                                         // Accumulator snapshot
   /*****************************************************************************************************************
-  ** Check to see if we have collected 10 or more readings each main loop iteration, and display the time and     **
-  ** average information before resetting the values. Interrupts are turned off when resetting the values to      **
-  ** ensure atomic operations                                                                                     **
+  ** Take the alerts the ISR has queued in the ring, read the registers of each unit and feed the samples to the  **
+  ** library's accumulators. The ISR is the only producer and loop() the only consumer, so interrupts are never   **
+  ** disabled. Display the statistics once we have 10 or more readings, the snapshot also resets the              **
+  ** accumulators.                                                                                                **
   *****************************************************************************************************************/
-  if (readings>=10) {                                                          // If it is time to display results
+  uint8_t count = INA226.readAlerts(alerts,batch,8);                           // Deferred I2C reads, up to 8
+  for (uint8_t i=0;i<count;i++) INA226.accumulate(batch[i]);                   // Integrate each sample
+  INA226.getStatistics(stats);                                                 // Look without resetting
+  if (stats.samples>=10) {                                                     // If it is time to display results
+    INA226.getStatistics(stats,true);                                          // Snapshot and reset together
     if(debug) Serial.print("Averaging readings over: ");
     if(debug) Serial.print((float)(millis()-lastMillis)/1000,2);
     if(debug) Serial.print(" seconds. Bus Volts: ");
-    if(debug) Serial.print((float)sumBusMillVolts/readings/1000.0,4);
+    if(debug) Serial.print(stats.busMilliVolts.mean/1000.0,4);
     if(debug) Serial.print("V Bus amperage: ");
-    if(debug) Serial.print((float)sumBusMicroAmps/readings/1000.0,4);
-    if(debug) Serial.println("mA"));
+    if(debug) Serial.print(stats.busMicroAmps.mean/1000.0,4);
+    if(debug) Serial.print("mA (");
+    if(debug) Serial.print(stats.busMicroAmps.minimum/1000.0,3);
+    if(debug) Serial.print("-");
+    if(debug) Serial.print(stats.busMicroAmps.maximum/1000.0,3);
+    if(debug) Serial.print("mA) Overruns: ");
+    if(debug) Serial.println(alerts.getOverruns());
     if(debug) Serial.println("-------------------------------------------------------------------");
     lastMillis = millis();
-    cli();                                                                     // Disable interrupts
-    readings        = 0;                                                       // Reset values
-    sumBusMillVolts = 0;                                                       // Reset values
-    sumBusMicroAmps = 0;                                                       // Reset values
-    sei();                                                                     // Enable interrupts
   }
 }
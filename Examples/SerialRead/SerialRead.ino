@@ -35,21 +35,24 @@ void setup() {
   // The begin initializes with expected 819 mA maximum current and for a 0.1 Ohm (100000 microOhm) resistor,
   // 1 device connected, I2C address of 0x40 (INA1). This assumes a ebay special INA226 board
   INA226.begin(819,100000, 0, INA1);
-  INA226.setAveraging(16);                                                     // Average each reading n-times
-  INA226.setBusConversion(4);                                                  // Maximum conversion time 1.1ms
-  INA226.setShuntConversion(4);                                                // Maximum conversion time 1.1ms
   INA226.setMode(INA_CONTINUOUS_BOTH);                                         // Bus/shunt measured continuously
+  INA226.tuneFor(1);                                                           // Least noise for 1 reading/second
 }
 
 void loop() {
+  INA226.resetBusCounters();                                                   // Count the I2C cost of one sample
+  inaREADING reading = INA226.readAll();                                       // Read all values from unit 0
   Serial.print("Bus Volts: ");
-  Serial.print((float)INA226.getBusMilliVolts(INA1)/1000.0,4);                 // Convert to millivolts
+  Serial.print((float)reading.busMilliVolts/1000.0,4);                         // Convert to volts
   Serial.print("V Shunt Volts: ");
-  Serial.print((float)INA226.getShuntMicroVolts(INA1)/1000.0,3);               // Convert to millivolts
+  Serial.print((float)reading.shuntMicroVolts/1000.0,3);                       // Convert to millivolts
   Serial.print("mV Bus Amps: ");
-  Serial.print((float)INA226.getBusMicroAmps(INA1)/1000.0,3);                  // Convert to milliamp
+  Serial.print((float)reading.busMicroAmps/1000.0,3);                          // Convert to milliamp
   Serial.print("mA Bus Watts: ");
-  Serial.print((float)INA226.getBusMicroWatts(INA1)/1000.0,3);                 // Convert to milliwatts
-  Serial.println("mW");
+  Serial.print((float)reading.busMicroWatts/1000.0,3);                         // Convert to milliwatts
+  Serial.print("mW I2C transactions: ");
+  Serial.print(INA226.getTransactionCount());                                  // Bus transactions for the sample
+  Serial.print(" bytes: ");
+  Serial.println(INA226.getByteCount());                                       // Bytes on the wire for the sample
   delay(1000);
 }
@@ -0,0 +1,52 @@
+/*******************************************************************************************************************
+** Minimal Arduino core replacement for building the INA226 library on a Linux host. Only what the library and    **
+** the simulator use is provided. Time is simulated: micros() and delayMicroseconds() advance the simulated       **
+** clock kept by INA226_Sim.cpp, and every micros() call costs one microsecond of CPU time so that busy loops     **
+** in the library always make progress.                                                                           **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#ifndef INA226_HOST_ARDUINO_h
+#define INA226_HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef bool    boolean;                                                       // Arduino type names
+typedef uint8_t byte;
+
+#define HIGH                           1                                       // Pin levels
+#define LOW                            0
+#define INPUT                          0                                       // Pin modes
+#define OUTPUT                         1
+#define INPUT_PULLUP                   2
+#define B000                           0                                       // Binary constants used
+#define B001                           1
+#define B010                           2
+#define B011                           3
+#define B100                           4
+#define B101                           5
+#define B110                           6
+#define B111                           7
+#define bitRead(value,bit) (((value)>>(bit))&0x01)                             // Bit helpers
+#define bit(b)             (1UL<<(b))
+
+uint32_t micros();                                                             // Simulated time in microseconds
+uint32_t millis();                                                             // Simulated time in milliseconds
+void delayMicroseconds(unsigned int us);                                       // Advance simulated time
+void delay(unsigned long ms);                                                  // Advance simulated time
+void pinMode(uint8_t pin,uint8_t mode);                                        // Record pin mode
+void digitalWrite(uint8_t pin,uint8_t level);                                  // Record pin level
+int  digitalRead(uint8_t pin);                                                 // Return recorded pin level
+inline void noInterrupts() {}                                                  // Single threaded host
+inline void interrupts()   {}
+
+#endif // END INA226_HOST_ARDUINO_h
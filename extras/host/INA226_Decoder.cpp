@@ -0,0 +1,155 @@
+/*******************************************************************************************************************
+** Binary stream decoder method definitions for the host tools of the INA226 library.                             **
+**                                                                                                                **
+** See the INA226_Decoder.h and DBOE_INA226.h header file comments for a description of the stream format.        **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#include "INA226_Decoder.h"                                                    // Include the header definition
+
+#define DECODER_MAX_RECORDS (INA_FRAME_MAX_PAYLOAD/4+1)                        // Shortest record is 4 bytes
+
+INA226_Decoder::INA226_Decoder() : sampleHandler(NULL), handlerContext(NULL), frames(0), headers(0), samples(0),
+                                   crcErrors(0), lostFrames(0), malformed(0), skippedBytes(0), _length(0),
+                                   _synced(false), _sequence(0) {
+  memset(_units,0,sizeof(_units));                                             // No metadata yet
+} // END of constructor
+
+/*******************************************************************************************************************
+** Method feed appends bytes to the partial frame and handles every frame completed by them. A frame failing its  **
+** CRC is dropped one byte at a time so a SYNC value inside a damaged frame can't hide the next good frame.       **
+*******************************************************************************************************************/
+void INA226_Decoder::feed(const uint8_t data[],size_t length) {
+  for (size_t i=0;i<length;i++) {
+    if (_length==0 && data[i]!=INA_FRAME_SYNC) {                               // Waiting for the start of a frame
+      skippedBytes++;
+      continue;
+    }
+    _buffer[_length++] = data[i];
+    while (_length>=3 && _length>=_buffer[2]+INA_FRAME_OVERHEAD) {             // A whole frame is buffered
+      uint16_t size = _buffer[2]+INA_FRAME_OVERHEAD;                           // Bytes in this frame
+      uint16_t crc  = _buffer[size-2]|(uint16_t)_buffer[size-1]<<8;            // Little endian CRC
+      uint16_t drop = size;                                                    // Bytes to remove
+      if (INA226_Encoder::crc16(&_buffer[1],size-3)!=crc) {                    // Damaged or a false SYNC
+        crcErrors++;
+        drop = 1;                                                              // Resynchronise after the SYNC
+      } else if (frame(_buffer[1],&_buffer[3],_buffer[2])) {
+        frames++;
+      } else {
+        malformed++;
+      }
+      memmove(_buffer,&_buffer[drop],_length-drop);                            // Remove handled bytes
+      _length -= drop;
+      uint16_t skip = 0;                                                       // Find the next SYNC
+      while (skip<_length && _buffer[skip]!=INA_FRAME_SYNC) skip++;
+      memmove(_buffer,&_buffer[skip],_length-skip);
+      _length -= skip;
+      skippedBytes += skip;
+    }
+  }
+} // END of method feed()
+
+const inaUNITINFO& INA226_Decoder::unitInfo(uint8_t unit) {
+  return(_units[unit&INA_FRAME_MAX_UNIT]);                                     // return unit metadata
+} // END of method unitInfo()
+
+/*******************************************************************************************************************
+** Method scale turns a raw sample into a reading with the same equations and integer arithmetic as readAll()     **
+*******************************************************************************************************************/
+bool INA226_Decoder::scale(const inaSAMPLE &sample,inaREADING &reading) {
+  const inaUNITINFO &unit = _units[sample.unit&INA_FRAME_MAX_UNIT];            // Metadata for the unit
+  memset(&reading,0,sizeof(reading));
+  reading.shuntRaw        = sample.shuntRaw;
+  reading.busRaw          = sample.busRaw;
+  reading.shuntMicroVolts = (int32_t)sample.shuntRaw*INA_SHUNT_VOLT_LSB/10;    // Convert to microvolts
+  reading.busMilliVolts   = (uint32_t)sample.busRaw*INA_BUS_VOLT_LSB/100;      // Convert to millivolts
+  if (!unit.valid) return(false);                                              // Can't scale current or power
+  int32_t currentRaw = (int32_t)sample.shuntRaw*unit.calibration/2048;         // Current = Shunt*Cal/2048
+  if (currentRaw> 32767) currentRaw =  32767;                                  // Limit to register range
+  if (currentRaw<-32768) currentRaw = -32768;
+  uint32_t powerRaw = (uint32_t)(currentRaw<0 ? -currentRaw : currentRaw)*sample.busRaw/20000;
+  if (powerRaw>65535) powerRaw = 65535;                                        // Power = Current*Bus/20000
+  reading.currentRaw    = (int16_t)currentRaw;
+  reading.powerRaw      = (uint16_t)powerRaw;
+  reading.busMicroAmps  = (int64_t)reading.currentRaw*unit.current_LSB/1000;   // Convert to microamps
+  reading.busMicroWatts = (int64_t)reading.powerRaw*unit.power_LSB/1000;       // Convert to microwatts
+  return(true);
+} // END of method scale()
+
+bool INA226_Decoder::getVarint(const uint8_t payload[],uint8_t length,uint8_t &pos,uint32_t &value) {
+  value = 0;
+  for (uint8_t shift=0;shift<35;shift+=7) {                                    // At most 5 bytes for 32 bits
+    if (pos>=length) return(false);                                            // Ran off the end of the frame
+    uint8_t byte = payload[pos++];
+    value |= (uint32_t)(byte&0x7F)<<shift;
+    if (!(byte&0x80)) return(true);                                            // Last byte
+  }
+  return(false);                                                               // Too long
+} // END of method getVarint()
+
+/*******************************************************************************************************************
+** Method frame handles one frame with a good CRC. Sample frames are decoded completely before any sample is      **
+** passed on, so a malformed frame is rejected as a whole.                                                        **
+*******************************************************************************************************************/
+bool INA226_Decoder::frame(uint8_t type,const uint8_t payload[],uint8_t length) {
+  if (type==INA_FRAME_HEADER) {                                                // Unit metadata
+    if (length!=14 || payload[0]!=INA_FRAME_VERSION || payload[1]>INA_FRAME_MAX_UNIT) return(false);
+    inaUNITINFO &unit = _units[payload[1]];
+    unit.valid       = true;
+    unit.address     = payload[2];
+    unit.bus         = payload[3];
+    unit.calibration = payload[4]|(uint16_t)payload[5]<<8;
+    unit.current_LSB = payload[6]|(uint32_t)payload[7]<<8|(uint32_t)payload[8]<<16|(uint32_t)payload[9]<<24;
+    unit.power_LSB   = payload[10]|(uint32_t)payload[11]<<8|(uint32_t)payload[12]<<16|(uint32_t)payload[13]<<24;
+    headers++;
+    return(true);
+  }
+  if (type!=INA_FRAME_SAMPLES || length<5) return(false);                      // Unknown type or too short
+  inaSAMPLE records[DECODER_MAX_RECORDS];                                      // Decoded before use
+  int32_t   lastShunt[INA_FRAME_MAX_UNIT+1];                                   // Delta state per unit
+  int32_t   lastBus[INA_FRAME_MAX_UNIT+1];
+  bool      seen[INA_FRAME_MAX_UNIT+1];
+  memset(seen,0,sizeof(seen));
+  uint32_t  micros = payload[1]|(uint32_t)payload[2]<<8|(uint32_t)payload[3]<<16|(uint32_t)payload[4]<<24;
+  uint8_t   count  = 0;
+  uint8_t   pos    = 5;
+  while (pos<length) {
+    uint8_t  tag  = payload[pos++];
+    uint8_t  unit = tag&INA_FRAME_MAX_UNIT;
+    uint32_t step,shunt,bus;
+    if (!getVarint(payload,length,pos,step) || !getVarint(payload,length,pos,shunt) ||
+        !getVarint(payload,length,pos,bus)) return(false);                     // Truncated record
+    int32_t shuntValue = (int32_t)(shunt>>1)^-(int32_t)(shunt&1);             // Undo the zigzag encoding
+    int32_t busValue   = (int32_t)(bus>>1)^-(int32_t)(bus&1);
+    if (!(tag&INA_FRAME_ABSOLUTE)) {                                           // Delta from the last record
+      if (!seen[unit]) return(false);                                          // with nothing to refer to
+      shuntValue += lastShunt[unit];
+      busValue   += lastBus[unit];
+    }
+    if (shuntValue<-32768 || shuntValue>32767 || busValue<0 || busValue>65535) return(false);
+    micros += (uint32_t)((int32_t)(step>>1)^-(int32_t)(step&1));               // Signed time step
+    lastShunt[unit] = shuntValue;
+    lastBus[unit]   = busValue;
+    seen[unit]      = true;
+    records[count].micros   = micros;
+    records[count].unit     = unit;
+    records[count].shuntRaw = (int16_t)shuntValue;
+    records[count].busRaw   = (uint16_t)busValue;
+    count++;
+  }
+  if (_synced && payload[0]!=_sequence) lostFrames += (uint8_t)(payload[0]-_sequence);// Frames missing in between
+  _sequence = payload[0]+1;
+  _synced   = true;
+  for (uint8_t i=0;i<count;i++) {                                              // Hand the samples over
+    inaREADING reading;
+    bool scaled = scale(records[i],reading);
+    if (sampleHandler) sampleHandler(records[i],reading,scaled,handlerContext);
+    samples++;
+  }
+  return(true);
+} // END of method frame()
@@ -0,0 +1,60 @@
+/*******************************************************************************************************************
+** Decoder for the binary stream written by INA226_Encoder. Bytes from a capture are fed in any chunk size, every **
+** frame is checked against its CRC and the decoder resynchronises on the next SYNC byte after a bad frame. Unit  **
+** metadata from header frames is used to scale each raw sample exactly as the library's readAll() does, samples  **
+** of units without a header yet are passed on unscaled. Lost frames are detected from the sequence numbers.      **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#ifndef INA226_Decoder_h
+#define INA226_Decoder_h
+
+#include "DBOE_INA226.h"                                                       // Frame constants and structures
+
+/*****************************************************************************************************************
+** Declare structures used in the decoder                                                                       **
+*****************************************************************************************************************/
+typedef struct {                                                               // Metadata from a header frame
+  boolean  valid;                                                              // Header received for this unit
+  uint8_t  address;                                                            // I2C Address of device
+  uint8_t  bus;                                                                // BUS_ID the device is on
+  uint16_t calibration;                                                        // Calibration register value
+  uint32_t current_LSB;                                                        // Amperage LSB in nA
+  uint32_t power_LSB;                                                          // Wattage LSB in nW
+} inaUNITINFO; // of structure
+
+/*****************************************************************************************************************
+** Declare class headers                                                                                        **
+*****************************************************************************************************************/
+class INA226_Decoder {                                                         // Binary stream frame decoder
+  public:                                                                      // Publicly visible methods
+    INA226_Decoder();                                                          // Class constructor
+    void feed(const uint8_t data[],size_t length);                             // Decode a chunk of the stream
+    const inaUNITINFO& unitInfo(uint8_t unit);                                 // Metadata of a unit
+    bool scale(const inaSAMPLE &sample,inaREADING &reading);                   // false if no header for the unit
+    void (*sampleHandler)(const inaSAMPLE &sample,const inaREADING &reading,   // Called for every sample
+                          bool scaled,void *context);
+    void *handlerContext;                                                      // Passed to sampleHandler
+    uint32_t frames;                                                           // Good frames decoded
+    uint32_t headers;                                                          // Header frames among them
+    uint32_t samples;                                                          // Sample records decoded
+    uint32_t crcErrors;                                                        // Frames failing the CRC
+    uint32_t lostFrames;                                                       // Gaps in the sequence numbers
+    uint32_t malformed;                                                        // Frames with a good CRC but bad data
+    uint32_t skippedBytes;                                                     // Bytes outside of any frame
+  private:                                                                     // Private variables and methods
+    bool frame(uint8_t type,const uint8_t payload[],uint8_t length);           // Handle one frame, false if bad
+    static bool getVarint(const uint8_t payload[],uint8_t length,uint8_t &pos,uint32_t &value);
+    inaUNITINFO _units[INA_FRAME_MAX_UNIT+1];                                  // Metadata per unit
+    uint8_t  _buffer[INA_FRAME_MAX_PAYLOAD+INA_FRAME_OVERHEAD];                // Partial frame
+    uint16_t _length;                                                          // Bytes in _buffer
+    bool     _synced;                                                          // A sample frame has been seen
+    uint8_t  _sequence;                                                        // Expected next sequence number
+}; // END of INA226_Decoder definition
+
+#endif // END INA226_Decoder_h
@@ -0,0 +1,363 @@
+/*******************************************************************************************************************
+** Simulated INA226 bus and device method definitions for the host build of the INA226 library.                   **
+**                                                                                                                **
+** See the INA226_Sim.h header file comments for a description of what is modelled.                               **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#include "INA226_Sim.h"                                                        // Include the header definition
+
+static const uint16_t simConversionMicros[8] = {140,204,332,588,1100,2116,4156,8244};// Datasheet times
+static const uint16_t simAverages[8]         = {1,4,16,64,128,256,512,1024};   // Averages per code
+static uint64_t       simNow                 = 0;                              // Simulated time
+static INA226_SimBus *simBuses[INA_SIM_MAX_BUSES];                             // Buses to keep up to date
+static uint8_t        simBusCount            = 0;
+static uint8_t        simPins[256];                                            // Levels from digitalWrite()
+INA226_SimBus         inaSimBus;                                               // Default bus, like Wire
+
+/*******************************************************************************************************************
+** Simulated time. Advancing the clock runs any conversions that complete in the meantime on every bus.           **
+*******************************************************************************************************************/
+uint64_t inaSimNow() {
+  return(simNow);                                                              // return simulated time
+} // END of function inaSimNow()
+
+void inaSimAdvance(uint64_t us) {
+  simNow += us;                                                                // Move the clock forward
+  for (uint8_t i=0;i<simBusCount;i++) simBuses[i]->update(simNow);             // and let devices catch up
+} // END of function inaSimAdvance()
+
+/*******************************************************************************************************************
+** Arduino core functions used by the library                                                                     **
+*******************************************************************************************************************/
+uint32_t micros() {
+  inaSimAdvance(1);                                                            // Each call costs 1us of CPU
+  return((uint32_t)simNow);                                                    // Wraps like the real thing
+} // END of function micros()
+
+uint32_t millis() {
+  return(micros()/1000);                                                       // return milliseconds
+} // END of function millis()
+
+void delayMicroseconds(unsigned int us) {
+  inaSimAdvance(us);                                                           // Advance simulated time
+} // END of function delayMicroseconds()
+
+void delay(unsigned long ms) {
+  inaSimAdvance((uint64_t)ms*1000);                                            // Advance simulated time
+} // END of function delay()
+
+void pinMode(uint8_t,uint8_t) {}                                               // Nothing to configure
+
+void digitalWrite(uint8_t pin,uint8_t level) {
+  simPins[pin] = level;                                                        // Record the level
+} // END of function digitalWrite()
+
+int digitalRead(uint8_t pin) {
+  return(simPins[pin]);                                                        // return recorded level
+} // END of function digitalRead()
+
+/*******************************************************************************************************************
+** INA226_SimDevice methods                                                                                       **
+*******************************************************************************************************************/
+INA226_SimDevice::INA226_SimDevice() : alertHandler(NULL), alertContext(NULL), _inputShunt(0), _inputBus(0),
+                                       _noise(0), _random(0x2545F491), _dieId(INA_SIM_DIE_ID) {
+  reset();                                                                     // Power-on state
+} // END of constructor
+
+void INA226_SimDevice::reset() {                                               // Power-on/software reset
+  _config = 0x4127;                                                            // Datasheet reset values
+  _shunt = 0; _bus = 0; _power = 0; _current = 0;
+  _calibration = 0; _mask = 0; _limit = 0;
+  _conversionReady = false; _alertFlag = false; _overflow = false; _alertPin = false;
+  _converting = true;                                                          // Continuous mode after reset
+  _conversionStart = simNow;
+  _conversions = 0;
+  pointer = 0;
+} // END of method reset()
+
+void INA226_SimDevice::setShuntMicroVolts(int32_t microVolts) {
+  _inputShunt = microVolts;                                                    // Used by the next conversion
+} // END of method setShuntMicroVolts()
+
+void INA226_SimDevice::setBusMilliVolts(uint32_t milliVolts) {
+  _inputBus = milliVolts;                                                      // Used by the next conversion
+} // END of method setBusMilliVolts()
+
+void INA226_SimDevice::setShuntNoise(uint16_t microVolts) {
+  _noise = microVolts;                                                         // Used by the next conversion
+} // END of method setShuntNoise()
+
+void INA226_SimDevice::setDieId(uint16_t id) {
+  _dieId = id;                                                                 // Returned by register 0xFF
+} // END of method setDieId()
+
+float INA226_SimDevice::gaussian() {                                           // Unit variance random value
+  float sum = 0;                                                               // Sum of 12 uniform values
+  for (uint8_t i=0;i<12;i++) {
+    _random ^= _random<<13; _random ^= _random>>17; _random ^= _random<<5;     // xorshift32, repeatable runs
+    sum += (float)_random/4294967296.0f;
+  }
+  return(sum-6);
+} // END of method gaussian()
+
+bool INA226_SimDevice::alertActive() {
+  return(_alertPin);                                                           // return ALERT pin state
+} // END of method alertActive()
+
+uint32_t INA226_SimDevice::getConversions() {
+  return(_conversions);                                                        // return conversions completed
+} // END of method getConversions()
+
+uint64_t INA226_SimDevice::period() {                                          // Microseconds per conversion
+  uint64_t time = 0;                                                           // Sum of active conversion times
+  if (_config&0x0001) time += simConversionMicros[(_config>>3)&7];             // Shunt measurement active
+  if (_config&0x0002) time += simConversionMicros[(_config>>6)&7];             // Bus measurement active
+  return(time*simAverages[(_config>>9)&7]);                                    // times the number of averages
+} // END of method period()
+
+void INA226_SimDevice::update(uint64_t now) {                                  // Complete due conversions
+  if (!_converting) return;                                                    // Idle or powered down
+  uint64_t time = period();
+  if (time==0 || now-_conversionStart<time) return;                            // Not finished yet
+  if (_config&0x0004) {                                                        // Continuous, skip whole periods
+    uint64_t finished = (now-_conversionStart)/time;
+    _conversionStart += finished*time;
+    _conversions     += finished;
+  } else {                                                                     // Triggered, one conversion only
+    _converting = false;
+    _conversions++;
+  }
+  complete();                                                                  // Results and flags
+} // END of method update()
+
+void INA226_SimDevice::complete() {                                            // Load results, update flags
+  if (_config&0x0001) {                                                        // Shunt LSB is 2.5uV
+    int32_t shunt = _inputShunt*10/25;
+    if (_noise) {                                                              // Noise over the integration time
+      float integration = (float)simConversionMicros[(_config>>3)&7]*simAverages[(_config>>9)&7];
+      shunt = lroundf((_inputShunt+_noise*sqrtf(1100/integration)*gaussian())*10/25);
+    }
+    _shunt = shunt>32767 ? 32767 : shunt<-32768 ? -32768 : shunt;
+  }
+  if (_config&0x0002) {                                                        // Bus LSB is 1.25mV
+    uint32_t bus = _inputBus*100/125;
+    _bus = bus>0x7FFF ? 0x7FFF : bus;
+  }
+  int32_t current = (int32_t)_shunt*_calibration/2048;                         // Datasheet equation 3
+  _overflow = current>32767 || current<-32768;
+  _current  = current>32767 ? 32767 : current<-32768 ? -32768 : current;
+  uint32_t power = (uint32_t)(_current<0 ? -(int32_t)_current : _current)*_bus/20000;// Datasheet equation 4
+  _power = power>0xFFFF ? 0xFFFF : power;
+  _conversionReady = true;                                                     // Set CVRF
+  evaluateAlert(true);                                                         // Limits are checked now
+} // END of method complete()
+
+void INA226_SimDevice::evaluateAlert(bool conversionDone) {                    // Work out the ALERT pin state
+  bool wasActive = _alertPin;                                                  // To detect the edge
+  bool condition = false;                                                      // Selected function triggered
+  if      (_mask&0x8000) condition = conversionDone && _shunt>(int16_t)_limit; // Shunt over-limit
+  else if (_mask&0x4000) condition = conversionDone && _shunt<(int16_t)_limit; // Shunt under-limit
+  else if (_mask&0x2000) condition = conversionDone && _bus>_limit;            // Bus over-limit
+  else if (_mask&0x1000) condition = conversionDone && _bus<_limit;            // Bus under-limit
+  else if (_mask&0x0800) condition = conversionDone && _power>_limit;          // Power over-limit
+  else if (_mask&0x0400) condition = _conversionReady;                         // Conversion ready
+  else { _alertFlag = false; _alertPin = false; return; }                      // No function selected
+  if (!conversionDone && !(_mask&0x0400)) return;                              // Limits only change on conversion
+  if (condition) {                                                             // Assert the pin
+    _alertFlag = true;
+    _alertPin  = true;
+  } else if (!(_mask&0x0001)) {                                                // Transparent mode follows the
+    _alertFlag = false;                                                        // condition
+    _alertPin  = false;
+  }
+  if (_alertPin && !wasActive && alertHandler) alertHandler(alertContext);     // Falling edge on the real pin
+} // END of method evaluateAlert()
+
+uint16_t INA226_SimDevice::readRegister(uint8_t reg) {                         // Register read with side effects
+  uint16_t value;                                                              // Hold the value to return
+  switch (reg) {
+    case 0:    return(_config);
+    case 1:    return(_shunt);
+    case 2:    return(_bus);
+    case 3:    return(_power);
+    case 4:    return(_current);
+    case 5:    return(_calibration);
+    case 6:    value = _mask | (_alertFlag<<4) | (_conversionReady<<3) | (_overflow<<2);
+               _conversionReady = false;                                       // Reading clears CVRF
+               if ((_mask&0x0001) || (_mask&0x0400)) {                         // and the latched or conversion
+                 _alertFlag = false;                                           // ready alert
+                 _alertPin  = false;
+               }
+               return(value);
+    case 7:    return(_limit);
+    case 0xFE: return(INA_SIM_MANUFACTURER_ID);
+    case 0xFF: return(_dieId);
+    default:   return(0);
+  }
+} // END of method readRegister()
+
+void INA226_SimDevice::writeRegister(uint8_t reg,uint16_t value) {             // Register write with side effects
+  switch (reg) {
+    case 0: if (value&0x8000) { reset(); return; }                             // Software reset
+            _config = value;
+            _conversionReady = false;                                          // Writing clears CVRF
+            if ((_mask&0x0400) && !(_mask&0xF800)) _alertPin = false;          // and a conversion ready alert
+            _converting = (value&0x0003)!=0;                                   // Power-down has nothing to do
+            _conversionStart = simNow;                                         // Restart or trigger conversion
+            return;
+    case 5: _calibration = value&0x7FFF; return;                               // Bit 15 is reserved
+    case 6: _mask = value&0xFC03;                                              // Only the writable bits
+            evaluateAlert(false);
+            return;
+    case 7: _limit = value; return;
+    default: return;                                                           // Read-only registers
+  }
+} // END of method writeRegister()
+
+/*******************************************************************************************************************
+** INA226_SimBus methods. Bus time is accounted as one START bit, nine clocks per byte including the acknowledge  **
+** and one STOP bit at the configured SCL frequency.                                                              **
+*******************************************************************************************************************/
+INA226_SimBus::INA226_SimBus() : transactions(0), bytes(0), busMicros(0), protocolErrors(0),
+                                 _clock(INA_SIM_DEFAULT_CLOCK),
+                                 _address(0), _txLength(0), _rxLength(0), _rxIndex(0),
+                                 _fault(INA_SIM_FAULT_NONE), _faultCount(0), _highSpeed(false) {
+  memset(_present,0,sizeof(_present));                                         // Empty bus
+  if (simBusCount<INA_SIM_MAX_BUSES) simBuses[simBusCount++] = this;           // Keep it updated
+} // END of constructor
+
+INA226_SimBus::~INA226_SimBus() {                                              // Class destructor
+  for (uint8_t i=0;i<simBusCount;i++) if (simBuses[i]==this) {                 // Stop updating this bus so a
+    simBuses[i] = simBuses[--simBusCount];                                     // new one can take its place
+    break;
+  }
+} // END of destructor
+
+INA226_SimDevice& INA226_SimBus::attach(uint8_t address) {                     // Put a device on the bus
+  uint8_t index = (address-INA_SIM_FIRST_ADDRESS)%INA_SIM_DEVICES;             // Slot for this address
+  _devices[index] = INA226_SimDevice();                                        // Fresh power-on state
+  _present[index] = true;
+  return(_devices[index]);
+} // END of method attach()
+
+void INA226_SimBus::detach(uint8_t address) {                                  // Take a device off the bus
+  if (device(address)) _present[address-INA_SIM_FIRST_ADDRESS] = false;
+} // END of method detach()
+
+INA226_SimDevice* INA226_SimBus::device(uint8_t address) {                     // Device at address or NULL
+  if (address<INA_SIM_FIRST_ADDRESS || address>=INA_SIM_FIRST_ADDRESS+INA_SIM_DEVICES) return(NULL);
+  return(_present[address-INA_SIM_FIRST_ADDRESS] ? &_devices[address-INA_SIM_FIRST_ADDRESS] : NULL);
+} // END of method device()
+
+void INA226_SimBus::begin() {}                                                 // Nothing to start
+
+void INA226_SimBus::setClock(uint32_t clock) {
+  _clock = clock;                                                              // Used for bus time
+} // END of method setClock()
+
+void INA226_SimBus::beginTransmission(uint8_t address) {
+  _address  = address;                                                         // Queue a write
+  _txLength = 0;
+} // END of method beginTransmission()
+
+size_t INA226_SimBus::write(uint8_t data) {
+  if (_txLength>=INA_SIM_BUFFER) return(0);                                    // Buffer full
+  _txBuffer[_txLength++] = data;
+  return(1);
+} // END of method write()
+
+uint8_t INA226_SimBus::endTransmission(bool sendStop) {
+  INA226_SimDevice *target = device(_address);                                 // Who answers
+  transactions++;
+  if (_address==INA_SIM_HS_MASTER_CODE && _txLength==0) {                      // HS master code, never ACKed
+    if (_clock>INA_SIM_FAST_CLOCK) protocolErrors++;                           // Must be sent at F/S speed
+    bytes++;
+    clockBits(1+9+(sendStop ? 1 : 0));
+    _highSpeed = !sendStop;                                                    // HS until the next STOP
+    return(2);
+  }
+  if (!clockValid() || !target || fault(INA_SIM_FAULT_NACK)) {                 // NACK on address, master stops
+    bytes++;
+    clockBits(1+9+1);                                                          // START, address and STOP
+    _highSpeed = false;
+    return(2);
+  }
+  bytes += 1+_txLength;                                                        // Address and data bytes
+  clockBits(1+9*(1+_txLength)+(sendStop ? 1 : 0));                             // START, bytes and STOP
+  if (sendStop) _highSpeed = false;                                            // STOP ends HS mode
+  if (fault(INA_SIM_FAULT_TIMEOUT)) return(5);                                 // Lost, nothing written
+  if (_txLength>=1) target->pointer = _txBuffer[0];                            // Register pointer
+  if (_txLength>=3) target->writeRegister(target->pointer,((uint16_t)_txBuffer[1]<<8)|_txBuffer[2]);
+  return(0);                                                                   // Success
+} // END of method endTransmission()
+
+uint8_t INA226_SimBus::requestFrom(uint8_t address,uint8_t quantity,uint8_t sendStop) {
+  INA226_SimDevice *target = device(address);                                  // Who answers
+  if (quantity>INA_SIM_BUFFER) quantity = INA_SIM_BUFFER;
+  transactions++;
+  _rxIndex  = 0;
+  _rxLength = 0;
+  if (!clockValid() || !target || fault(INA_SIM_FAULT_NACK)) {                 // NACK on address, master stops
+    bytes++;
+    clockBits(1+9+1);                                                          // START, address and STOP
+    _highSpeed = false;
+    return(0);
+  }
+  if (quantity>0 && fault(INA_SIM_FAULT_SHORT_READ)) quantity--;               // Slave stops early
+  bytes += 1+quantity;                                                         // Address and data bytes
+  clockBits(1+9*(1+quantity)+(sendStop ? 1 : 0));                              // START, bytes and STOP
+  if (sendStop) _highSpeed = false;                                            // STOP ends HS mode
+  uint16_t value = target->readRegister(target->pointer);                      // MSB first, then LSB, repeated
+  for (_rxLength=0;_rxLength<quantity;_rxLength++)
+    _rxBuffer[_rxLength] = (_rxLength&1) ? (uint8_t)value : (uint8_t)(value>>8);
+  return(_rxLength);
+} // END of method requestFrom()
+
+int INA226_SimBus::read() {
+  return(_rxIndex<_rxLength ? _rxBuffer[_rxIndex++] : -1);                     // -1 when nothing is left
+} // END of method read()
+
+int INA226_SimBus::available() {
+  return(_rxLength-_rxIndex);                                                  // Bytes not yet read
+} // END of method available()
+
+void INA226_SimBus::update(uint64_t now) {                                     // Update all attached devices
+  for (uint8_t i=0;i<INA_SIM_DEVICES;i++) if (_present[i]) _devices[i].update(now);
+} // END of method update()
+
+void INA226_SimBus::resetStats() {                                             // Zero the statistics
+  transactions   = 0;
+  bytes          = 0;
+  busMicros      = 0;
+  protocolErrors = 0;
+} // END of method resetStats()
+
+void INA226_SimBus::injectFault(uint8_t fault,uint8_t count) {                 // Fail the next count transfers
+  _fault      = fault;                                                         // of the matching kind
+  _faultCount = count;
+} // END of method injectFault()
+
+bool INA226_SimBus::clockValid() {                                             // SCL legal in current mode
+  if (_clock<=INA_SIM_FAST_CLOCK) return(true);                                // Standard and fast mode
+  if (_highSpeed && _clock<=INA_SIM_HS_CLOCK) return(true);                    // HS mode after the master code
+  protocolErrors++;                                                            // Devices can't follow
+  return(false);
+} // END of method clockValid()
+
+bool INA226_SimBus::fault(uint8_t kind) {                                      // Use up one injected fault
+  if (_fault!=kind || _faultCount==0) return(false);
+  if (--_faultCount==0) _fault = INA_SIM_FAULT_NONE;
+  return(true);
+} // END of method fault()
+
+void INA226_SimBus::clockBits(uint32_t bits) {                                 // Account for bus time
+  uint64_t us = ((uint64_t)bits*1000000+_clock-1)/_clock;                      // Rounded up
+  busMicros += us;
+  inaSimAdvance(us);                                                           // Devices keep converting
+} // END of method clockBits()
@@ -0,0 +1,133 @@
+/*******************************************************************************************************************
+** Register accurate simulation of INA226 devices on an I2C bus, used as the transport for the host build of the  **
+** library. INA226_SimBus offers the same methods as the Arduino TwoWire class and counts transactions, bytes and **
+** the time the bus is busy at the configured clock. INA226_SimDevice models the register set with its reset      **
+** defaults, the calibration, current and power equations, conversion timing for all averaging and conversion     **
+** time settings, continuous, triggered and power-down modes, the conversion ready flag and the alert functions.  **
+** NACKs, short reads and timeouts can be injected on the bus to exercise the error handling of the library.      **
+** High-speed mode is entered with the master code and left at the next STOP, clocks above 400kHz outside HS      **
+** mode are counted as protocol errors and not acknowledged. Gaussian shunt noise can be added to the input, it   **
+** falls with the square root of the integration time as on the real device.                                     **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#ifndef INA226_Sim_h
+#define INA226_Sim_h
+
+#include "Arduino.h"
+
+/*****************************************************************************************************************
+** Declare constants used in the simulator                                                                      **
+*****************************************************************************************************************/
+#define INA_SIM_FIRST_ADDRESS       0x40                                       // Lowest INA226 address
+#define INA_SIM_DEVICES               16                                       // Addresses 0x40 to 0x4F
+#define INA_SIM_MAX_BUSES              8                                       // Buses inaSimAdvance() updates
+#define INA_SIM_BUFFER                32                                       // TwoWire buffer size
+#define INA_SIM_DEFAULT_CLOCK     100000                                       // Standard mode I2C
+#define INA_SIM_FAST_CLOCK        400000                                       // Fast mode limit
+#define INA_SIM_HS_CLOCK         2940000                                       // INA226 HS-mode limit
+#define INA_SIM_HS_MASTER_CODE      0x04                                       // 00001XXX as a 7 bit address
+#define INA_SIM_MANUFACTURER_ID   0x5449                                       // "TI" in register 0xFE
+#define INA_SIM_DIE_ID            0x2260                                       // INA226 in register 0xFF
+#define INA_SIM_FAULT_NONE             0                                       // Faults injectFault() can cause
+#define INA_SIM_FAULT_NACK             1                                       // Address not acknowledged
+#define INA_SIM_FAULT_SHORT_READ       2                                       // requestFrom() one byte short
+#define INA_SIM_FAULT_TIMEOUT          3                                       // endTransmission() times out
+
+uint64_t inaSimNow();                                                          // Simulated time in microseconds
+void inaSimAdvance(uint64_t us);                                               // Advance time, run conversions
+
+/*****************************************************************************************************************
+** Declare class headers                                                                                        **
+*****************************************************************************************************************/
+class INA226_SimDevice {                                                       // One simulated INA226
+  public:                                                                      // Publicly visible methods
+    INA226_SimDevice();                                                        // Class constructor
+    void reset();                                                              // Power-on/software reset
+    void setShuntMicroVolts(int32_t microVolts);                               // Analog input across the shunt
+    void setBusMilliVolts(uint32_t milliVolts);                                // Analog input on VBUS
+    void setShuntNoise(uint16_t microVolts);                                   // rms at 1.1ms, no averaging
+    void setDieId(uint16_t id);                                                // Pose as another INA2xx part
+    bool alertActive();                                                        // State of the ALERT pin
+    uint32_t getConversions();                                                 // Conversions completed
+    void (*alertHandler)(void *context);                                       // Called on ALERT pin assertion
+    void *alertContext;                                                        // Passed to alertHandler
+    uint16_t readRegister(uint8_t reg);                                        // Register read with side effects
+    void writeRegister(uint8_t reg,uint16_t value);                            // Register write with side effects
+    void update(uint64_t now);                                                 // Complete due conversions
+    uint8_t pointer;                                                           // Register pointer
+  private:                                                                     // Private variables and methods
+    uint64_t period();                                                         // Microseconds per conversion
+    void complete();                                                           // Load results, update flags
+    void evaluateAlert(bool conversionReady);                                  // Work out the ALERT pin state
+    float gaussian();                                                          // Unit variance random value
+    uint16_t _config;                                                          // Register 0
+    int16_t  _shunt;                                                           // Register 1
+    uint16_t _bus;                                                             // Register 2
+    uint16_t _power;                                                           // Register 3
+    int16_t  _current;                                                         // Register 4
+    uint16_t _calibration;                                                     // Register 5
+    uint16_t _mask;                                                            // Register 6, writable bits
+    uint16_t _limit;                                                           // Register 7
+    bool     _conversionReady;                                                 // CVRF flag
+    bool     _alertFlag;                                                       // AFF flag
+    bool     _overflow;                                                        // OVF flag
+    bool     _alertPin;                                                        // ALERT pin asserted
+    bool     _converting;                                                      // A conversion is running
+    uint64_t _conversionStart;                                                 // Time the conversion started
+    uint32_t _conversions;                                                     // Conversions completed
+    int32_t  _inputShunt;                                                      // Shunt input in uV
+    uint32_t _inputBus;                                                        // Bus input in mV
+    uint16_t _noise;                                                           // Shunt noise at 1.1ms in uV rms
+    uint32_t _random;                                                          // Noise generator state
+    uint16_t _dieId;                                                           // Register 0xFF
+}; // END of INA226_SimDevice definition
+
+class INA226_SimBus {                                                          // Simulated I2C bus, TwoWire API
+  public:                                                                      // Publicly visible methods
+    INA226_SimBus();                                                           // Class constructor
+    ~INA226_SimBus();                                                          // Class destructor
+    INA226_SimDevice& attach(uint8_t address);                                 // Put a device on the bus
+    void detach(uint8_t address);                                              // Take a device off the bus
+    INA226_SimDevice* device(uint8_t address);                                 // Device at address or NULL
+    void begin();                                                              // TwoWire compatible methods
+    void setClock(uint32_t clock);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address,uint8_t quantity,uint8_t sendStop = 1);
+    int read();
+    int available();
+    void update(uint64_t now);                                                 // Update all attached devices
+    void resetStats();                                                         // Zero the statistics below
+    void injectFault(uint8_t fault,uint8_t count = 1);                         // Fail the next count transfers
+    uint32_t transactions;                                                     // START conditions on the bus
+    uint32_t bytes;                                                            // Bytes including addresses
+    uint64_t busMicros;                                                        // Time the bus was busy
+    uint32_t protocolErrors;                                                   // Clock too fast for the mode
+  private:                                                                     // Private variables and methods
+    void clockBits(uint32_t bits);                                             // Account for bus time
+    INA226_SimDevice _devices[INA_SIM_DEVICES];                                // Device storage
+    bool     _present[INA_SIM_DEVICES];                                        // Device attached at address
+    uint32_t _clock;                                                           // SCL frequency in Hz
+    uint8_t  _address;                                                         // Address being written
+    uint8_t  _txBuffer[INA_SIM_BUFFER];                                        // Bytes queued by write()
+    uint8_t  _txLength;
+    uint8_t  _rxBuffer[INA_SIM_BUFFER];                                        // Bytes from requestFrom()
+    uint8_t  _rxLength;
+    uint8_t  _rxIndex;
+    uint8_t  _fault;                                                           // INA_SIM_FAULT_ to inject
+    uint8_t  _faultCount;                                                      // Transfers still to fail
+    bool     fault(uint8_t kind);                                              // Use up one injected fault
+    bool     clockValid();                                                     // SCL legal in current mode
+    bool     _highSpeed;                                                       // Master code seen, no STOP yet
+}; // END of INA226_SimBus definition
+
+extern INA226_SimBus inaSimBus;                                                // Default bus, like Wire
+
+#endif // END INA226_Sim_h
@@ -0,0 +1,522 @@
+/*******************************************************************************************************************
+** Benchmark for the INA226 library on the simulated bus. Every public call is run against simulated devices and  **
+** the I2C transactions, bytes, bus time at the configured clock and total elapsed time are reported. Each call   **
+** has a transaction budget; the program exits with status 1 if a budget is exceeded, if the library's own        **
+** counters disagree with the bus or if a sanity check on the returned values fails, so it can be run in CI.      **
+** Each call starts from a fresh bus with four devices that have been scanned and configured, so any call can be  **
+** run on its own and a failure doesn't spill into the next: "./bench rack" runs only the calls with "rack" in    **
+** their name. Budgets are the exact counts, so a call that starts costing one more transaction fails.            **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#include <stdio.h>
+#include <new>                                                                 // Placement new for renew()
+#include "DBOE_INA226.h"                                                       // Library under test
+#include "INA226_Sim.h"                                                        // Simulated transport
+#include "INA226_Decoder.h"                                                    // Host side stream decoder
+
+#define BENCH_UNITS                    4                                       // Devices on the simulated bus
+#define BENCH_RELAY_PIN                7                                       // Pin driven by tripAlert()
+#define BENCH_SHUNT_MICROVOLTS     10000                                       // 100mA through 0.1 Ohm
+#define BENCH_BUS_MILLIVOLTS       12000                                       // 12V supply
+#define BENCH_STREAM_SAMPLES          60                                       // Samples sent through the encoder
+#define BENCH_NOISE_MICROVOLTS        50                                       // Shunt noise at 1.1ms for tuning
+#define BENCH_NOISE_TARGET            40                                       // adaptTuning() target in uV
+#define BENCH_SCHEDULE_MILLIS       1000                                       // setSchedule() interval
+#define BENCH_LONG_SAMPLES       1000000                                       // Samples for the statistics
+
+typedef struct {                                                               // One benchmark entry
+  const char *name;                                                            // Call being measured
+  uint16_t budget;                                                             // Maximum transactions allowed
+  void (*prepare)();                                                           // Unmeasured set up, may be NULL
+  void (*run)();                                                               // Measured call
+} benchCASE;
+
+static INA226_Bank<BENCH_UNITS> INA226;                                        // Library instance
+static INA226_Bank<BENCH_UNITS> rack;                                          // Instance spread over two buses
+static INA226_SimBus            simBus2;                                       // Second bus, like Wire1
+static INA226_Accumulators<BENCH_UNITS> accumulators;                          // Opt-in statistics storage
+static INA226_Telemetry<BENCH_UNITS> telemetry;                                // Opt-in I2C counters and latencies
+static INA226_Schedule<BENCH_UNITS> schedule;                                  // Duty cycle of the scheduled units
+static INA226_Trips<BENCH_UNITS>  trips;                                       // Opt-in relay and overload state
+static INA226_SampleBuffer<16>  samples;                                       // Alerts queued by markAlert()
+static inaREADING               readings[BENCH_UNITS];                         // Results of the last read
+static INA226_FrameBuffer<128>  frames;                                        // Binary stream encoder
+static uint8_t                  stream[1024];                                  // Encoded frames
+static uint16_t                 streamLength;                                  // Bytes in stream
+static inaSAMPLE                sent[BENCH_STREAM_SAMPLES];                    // Samples given to the encoder
+static uint8_t                  received;                                      // Samples out of the decoder
+static bool                     sane = true;                                   // Sanity checks of this call
+
+static void check(bool condition,const char *what) {                          // Record a failed sanity check
+  if (condition) return;
+  printf("SANITY CHECK FAILED: %s\n",what);
+  sane = false;
+} // END of function check()
+
+static void settle() {                                                         // Let every unit convert
+  delay(20);                                                                   // Longer than 4x(1.1+1.1)ms
+} // END of function settle()
+
+template<class T> static void renew(T &object) {                               // Destroy and construct again
+  object.~T();
+  new (&object) T();
+} // END of function renew()
+
+static void setupUnits() {                                                     // Known fast configuration
+  for (uint8_t unit=0;unit<BENCH_UNITS;unit++)
+    INA226.configure(unit).averaging(4).busConversion(4).shuntConversion(4).mode(INA_CONTINUOUS_BOTH).apply();
+  settle();
+} // END of function setupUnits()
+
+static void freshBench() {                                                     // Starting point of every call
+  renew(inaSimBus);                                                            // Power-on state, no devices
+  renew(simBus2);
+  renew(INA226);                                                               // Empty unit tables
+  renew(rack);
+  renew(samples);
+  renew(frames);
+  renew(accumulators);
+  renew(trips);
+  renew(telemetry);
+  renew(schedule);
+  for (uint8_t unit=0;unit<BENCH_UNITS;unit++) {                               // Populate the bus
+    INA226_SimDevice &device = inaSimBus.attach(0x40+unit);
+    device.setShuntMicroVolts(BENCH_SHUNT_MICROVOLTS);
+    device.setBusMilliVolts(BENCH_BUS_MILLIVOLTS);
+  }
+  check(INA226.scan(819,100000)==BENCH_UNITS,"scan found 4");
+  setupUnits();
+} // END of function freshBench()
+
+static void checkReading(const inaREADING &reading,const char *what) {         // Compare with the inputs
+  check(reading.busMilliVolts==BENCH_BUS_MILLIVOLTS,what);
+  check(reading.shuntMicroVolts==BENCH_SHUNT_MICROVOLTS,what);
+  check(reading.busMicroAmps>99900 && reading.busMicroAmps<100100,what);       // 100mA within 0.1%
+  check(reading.busMicroWatts>1195000 && reading.busMicroWatts<1205000,what);  // 1.2W within 0.5%
+} // END of function checkReading()
+
+static void setupRack() {                                                      // Two devices on each bus
+  for (uint8_t unit=0;unit<2;unit++) {
+    INA226_SimDevice &device0 = inaSimBus.attach(0x44+unit);                   // Next to the INA226 instance
+    INA226_SimDevice &device1 = simBus2.attach(0x40+unit);                     // Same addresses, other bus
+    device0.setShuntMicroVolts(BENCH_SHUNT_MICROVOLTS); device0.setBusMilliVolts(BENCH_BUS_MILLIVOLTS);
+    device1.setShuntMicroVolts(BENCH_SHUNT_MICROVOLTS); device1.setBusMilliVolts(BENCH_BUS_MILLIVOLTS);
+  }
+  check(rack.addBus(simBus2)==1,"addBus");
+  rack.setClock(INA_I2C_FAST_CLOCK,0);
+  rack.setClock(INA_I2C_FAST_CLOCK,1);
+} // END of function setupRack()
+
+static void startRack() {                                                      // Rack with all four units found
+  setupRack();
+  rack.begin(819,100000,0,0x44,0);
+  rack.begin(819,100000,1,0x45,0);
+  rack.scan(819,100000,1);
+  for (uint8_t unit=0;unit<BENCH_UNITS;unit++)
+    rack.configure(unit).averaging(1).busConversion(4).shuntConversion(4).apply();
+  settle();
+} // END of function startRack()
+
+static void acquireRack() {                                                    // 40 readings over both buses
+  uint8_t count = 0;
+  while (count<40) count += rack.acquire(readings);
+  checkReading(readings[1],"acquire bus 0");
+  checkReading(readings[3],"acquire bus 1");
+  printf("  bus 0 busy %llu us, bus 1 busy %llu us\n",(unsigned long long)inaSimBus.busMicros,
+         (unsigned long long)simBus2.busMicros);
+} // END of function acquireRack()
+
+static void appendFrame(uint16_t length) {                                    // Copy a finished frame
+  memcpy(&stream[streamLength],frames.data(),length);
+  streamLength += length;
+} // END of function appendFrame()
+
+static void receiveSample(const inaSAMPLE &sample,const inaREADING &reading,bool scaled,void *) {
+  if (received<BENCH_STREAM_SAMPLES) {                                         // Compare with what was sent
+    const inaSAMPLE &expected = sent[received];
+    check(sample.micros==expected.micros && sample.unit==expected.unit && sample.shuntRaw==expected.shuntRaw &&
+          sample.busRaw==expected.busRaw,"decoded sample");
+  }
+  check(scaled,"decoded sample scaled");
+  checkReading(reading,"decoded reading");
+  received++;
+} // END of function receiveSample()
+
+static uint16_t buildStream() {                                                // Headers, then raw samples
+  streamLength = 0;
+  for (uint8_t unit=0;unit<BENCH_UNITS;unit++) appendFrame(frames.header(INA226,unit));
+  uint16_t headerBytes = streamLength;
+  for (uint8_t i=0;i<BENCH_STREAM_SAMPLES;i++) {
+    sent[i] = INA226.readRaw(i%BENCH_UNITS);
+    if (!frames.add(sent[i])) {                                                // Frame full, send it
+      appendFrame(frames.finish());
+      frames.add(sent[i]);
+    }
+  }
+  appendFrame(frames.finish());
+  return(headerBytes);                                                         // return bytes before the samples
+} // END of function buildStream()
+
+static void encodeStream() {                                                   // Encode and decode in chunks
+  uint16_t headerBytes = buildStream();
+  printf("  %u bytes for %u samples, %.1f bytes per sample (%u as inaSAMPLE)\n",(unsigned)(streamLength-headerBytes),
+         BENCH_STREAM_SAMPLES,(double)(streamLength-headerBytes)/BENCH_STREAM_SAMPLES,(unsigned)sizeof(inaSAMPLE));
+  INA226_Decoder decoder;
+  decoder.sampleHandler = receiveSample;
+  received = 0;
+  for (uint16_t offset=0;offset<streamLength;offset+=7)                        // Frames split across chunks
+    decoder.feed(&stream[offset],streamLength-offset<7 ? streamLength-offset : 7);
+  check(received==BENCH_STREAM_SAMPLES && decoder.headers==BENCH_UNITS && decoder.crcErrors==0 &&
+        decoder.lostFrames==0 && decoder.malformed==0 && decoder.skippedBytes==0,"stream decoded");
+} // END of function encodeStream()
+
+static void decodeCorrupted() {                                                // One bad byte in a sample frame
+  uint16_t second = 19*BENCH_UNITS;                                            // Skip the header frames
+  second += stream[second+2]+INA_FRAME_OVERHEAD;                               // and the first sample frame
+  stream[second+10] ^= 0x10;                                                   // Inside the second sample frame
+  INA226_Decoder decoder;
+  decoder.feed(stream,streamLength);
+  check(decoder.crcErrors>=1 && decoder.lostFrames==1 && decoder.malformed==0,"corruption detected");
+  check(decoder.headers==BENCH_UNITS && decoder.samples>0 && decoder.samples<BENCH_STREAM_SAMPLES,"resynced");
+  printf("  %u of %u samples recovered, %u CRC errors, %u lost, %u bytes skipped\n",(unsigned)decoder.samples,
+         BENCH_STREAM_SAMPLES,(unsigned)decoder.crcErrors,(unsigned)decoder.lostFrames,
+         (unsigned)decoder.skippedBytes);
+} // END of function decodeCorrupted()
+
+static void printTuning(uint32_t period,uint8_t unit) {                       // Show the chosen setting
+  static const uint16_t averages[8] = {1,4,16,64,128,256,512,1024};            // Averages per code
+  uint16_t config = INA226.getConfiguration(unit);
+  printf("  %u averages, conversion code %u, period %u us\n",averages[config>>9&7],(unsigned)(config>>3&7),
+         (unsigned)period);
+} // END of function printTuning()
+
+static void sampleNoise() {                                                    // Feed the unit 2 accumulators
+  for (uint8_t i=0;i<2*INA_TUNE_MIN_SAMPLES;i++) {
+    INA226.waitForConversion(2);
+    INA226.readAll(2);
+  }
+} // END of function sampleNoise()
+
+static void noisyTuning() {                                                    // Unit 2 at 10Hz with noise
+  inaSimBus.device(0x42)->setShuntNoise(BENCH_NOISE_MICROVOLTS);
+  INA226.setAccumulators(accumulators);
+  INA226.setAccumulating(true,2);
+  INA226.tuneFor(10,2);
+  settle();
+  INA226.resetStatistics(2);
+  sampleNoise();
+} // END of function noisyTuning()
+
+static void triggeredUnits() {                                                 // Every unit in triggered mode
+  for (uint8_t unit=0;unit<BENCH_UNITS;unit++) INA226.setMode(INA_TRIGGERED_BOTH,unit);
+  settle();
+} // END of function triggeredUnits()
+
+static bool poweredDown(uint8_t address) {                                    // Mode bits of the device
+  return((inaSimBus.device(address)->readRegister(INA_CONFIG_REG)&INA_CONFIG_MODE_MASK)==INA_POWER_DOWN);
+} // END of function poweredDown()
+
+static void awaitSchedule() {                                                  // Run until a sample is taken
+  uint32_t start = millis();
+  while (INA226.runSchedule(schedule,readings)==0 && millis()-start<2*BENCH_SCHEDULE_MILLIS) delayMicroseconds(100);
+} // END of function awaitSchedule()
+
+static void scheduledSample() {                                                // Wait for one scheduled sample
+  uint32_t conversions = inaSimBus.device(0x43)->getConversions();
+  awaitSchedule();
+  checkReading(readings[3],"scheduled sample");
+  check(poweredDown(0x43) && inaSimBus.device(0x43)->getConversions()==conversions+1,"one conversion");
+  inaSAMPLEENERGY energy = schedule.getSampleEnergy(3);
+  check(energy.transactions==INA226.getTransactionCount() && energy.bytes==INA226.getByteCount(),"sample cost");
+  check(energy.busMicros+energy.transactions>=inaSimBus.busMicros &&            // Simulator rounds up per transfer
+        energy.busMicros<=inaSimBus.busMicros,"bus time estimate");
+  printf("  woken at %u ms, active %u us, bus %u us, device %u nJ, bus %u nJ per sample\n",(unsigned)millis(),
+         (unsigned)energy.activeMicros,(unsigned)energy.busMicros,(unsigned)energy.deviceNanoJoules,
+         (unsigned)energy.busNanoJoules);
+} // END of function scheduledSample()
+
+static void longStatistics() {                                                 // Sawtooth with a known result
+  inaSAMPLE sample = {0,0,BENCH_SHUNT_MICROVOLTS*10/INA_SHUNT_VOLT_LSB,0};     // Steady current
+  for (uint32_t i=0;i<BENCH_LONG_SAMPLES;i++) {
+    sample.micros += 1000;
+    sample.busRaw  = 9000+i%1000;                                              // 11.25V to 12.49875V
+    INA226.accumulate(sample);
+  }
+  inaSTATISTICS statistics;
+  INA226.getStatistics(statistics,false,0);
+  double mean     = 9499.5*1.25;                                               // Sawtooth mean, 1.25mV LSB
+  double variance = (1000.0*1000.0-1)/12*1.25*1.25*BENCH_LONG_SAMPLES/(BENCH_LONG_SAMPLES-1);
+  printf("  bus mean %.4f mV (exact %.4f), variance %.2f mV^2 (exact %.2f)\n",statistics.busMilliVolts.mean,mean,
+         statistics.busMilliVolts.variance,variance);
+  check(statistics.samples==BENCH_LONG_SAMPLES,"sample count");
+  check(fabs(statistics.busMilliVolts.mean-mean)<0.01,"mean");
+  check(fabs(statistics.busMilliVolts.variance/variance-1)<1e-4,"variance");
+  check(statistics.busMilliVolts.minimum==11250 && statistics.busMilliVolts.maximum==12498,"range");
+  check(statistics.busMicroAmps.variance==0,"steady current");
+} // END of function longStatistics()
+
+static void boundaryStatistics() {                                             // Widest power swing, the squares
+  const uint32_t last = INA_STATISTICS_MAX_SAMPLES;                            // wrap but the variance is just
+  inaACCUMULATOR &acc = *accumulators.unit(0);                                 // below 2^64: -65535 and +65535
+  acc.samples            = last-1;                                             // half each, one +65535 to come
+  acc.microWatts.minimum = acc.microWatts.baseline = -65535;
+  acc.microWatts.maximum = 65535;
+  acc.microWatts.sum     = (int64_t)(last/2)*131070;
+  acc.microWatts.squares = (uint64_t)(last/2)*131070*131070;                   // Wrapped modulo 2^64
+  inaREADING reading = {};                                                     // Positive current, power full
+  reading.currentRaw   = 1;
+  reading.powerRaw     = 65535;
+  reading.busMicroAmps = 1;
+  INA226.accumulate(reading,0,0);                                              // Sample 2^32-1
+  INA226.accumulate(reading,0,0);                                              // Beyond the cap, not counted
+  inaSTATISTICS statistics;
+  INA226.getStatistics(statistics,false,0);
+  long double plus     = last/2+1;                                             // Samples at +65535
+  long double scale    = INA226.getPowerLSB(0)/1000.0L;                        // uW per power LSB
+  long double mean     = (-65535.0L+131070.0L*plus/last)*scale;
+  long double variance = 131070.0L*131070.0L*plus*(last-plus)/last/(last-1)*scale*scale;
+  printf("  power mean %.1f uW (exact %.1f), variance %.4g uW^2 (exact %.4g)\n",statistics.busMicroWatts.mean,
+         (double)mean,statistics.busMicroWatts.variance,(double)variance);
+  check(statistics.samples==last,"capped sample count");
+  check(fabsl(statistics.busMicroWatts.mean-mean)<1.0L,"mean");
+  check(fabsl(statistics.busMicroWatts.variance/variance-1)<1e-4L,"variance");
+} // END of function boundaryStatistics()
+
+static void compareConverters(uint8_t unit) {                                  // Every shunt value at 12V and
+  INA226_Decoder decoder;                                                      // at full scale bus, which takes
+  uint16_t length = frames.header(INA226,unit);                                // the power register to 65535
+  decoder.feed(frames.data(),length);
+  uint32_t   mismatches = 0;
+  inaREADING expected,reading,fullScale = {};                                  // Decoder scales like readAll()
+  for (uint8_t pass=0;pass<2;pass++) {
+    for (int32_t shunt=-32768;shunt<=32767;shunt++) {
+      inaSAMPLE sample   = {0,unit,(int16_t)shunt,(uint16_t)(pass ? 65535 : 9600)};
+      int16_t   shuntRaw = shunt;
+      int32_t   microAmps,microWatts;
+      decoder.scale(sample,expected);
+      INA226.convertSamples(&sample,&reading,1);
+      INA226.convertCurrent(&shuntRaw,&microAmps,1,unit);
+      INA226.convertPower(&shuntRaw,&sample.busRaw,&microWatts,1,unit);
+      if (reading.busMicroAmps!=expected.busMicroAmps || reading.busMicroWatts!=expected.busMicroWatts ||
+          microAmps!=expected.busMicroAmps || microWatts!=expected.busMicroWatts) mismatches++;
+    }
+    if (!pass) fullScale = reading;
+  }
+  printf("  %u of 131072 shunt values differ from readAll(), full scale %ld uA, %ld uW\n",(unsigned)mismatches,
+         (long)fullScale.busMicroAmps,(long)fullScale.busMicroWatts);
+  check(mismatches==0,"converters match readAll()");
+} // END of function compareConverters()
+
+static void alertToMark(void *)  { INA226.markAlert(samples,0); }             // ALERT pin interrupt handlers
+static void alertToTrip(void *)  { INA226.tripAlert(0); }
+
+static const benchCASE benchCases[] = {
+  {"begin",                 9, NULL, [] { INA226.begin(819,100000,0,0x40); }},
+  {"scan (4 devices)",     36, NULL, [] { check(INA226.scan(819,100000)==BENCH_UNITS,"scan found 4"); }},
+  {"scan, other INA2xx",   41, [] { INA226_SimDevice &other = inaSimBus.attach(0x40);  // An INA260 shares the
+                                    other.setDieId(0x2270);                    // addresses and the maker ID
+                                    other.writeRegister(INA_CONFIG_REG,0x6527);
+                                    INA226_SimDevice &extra = inaSimBus.attach(0x44);
+                                    extra.setShuntMicroVolts(BENCH_SHUNT_MICROVOLTS);
+                                    extra.setBusMilliVolts(BENCH_BUS_MILLIVOLTS); },
+                               [] { check(INA226.scan(819,100000)==BENCH_UNITS,"scan found 4");
+                                    check(INA226.getAddress(0)==0x41 && INA226.getAddress(3)==0x44,"INA226s only");
+                                    check(inaSimBus.device(0x40)->readRegister(INA_CONFIG_REG)==0x6527,
+                                          "other device not reset"); }},
+  {"configure().apply()",   1, NULL, [] { INA226.configure().averaging(4).busConversion(4).shuntConversion(4)
+                                                   .mode(INA_CONTINUOUS_BOTH).apply(); }},
+  {"setMode",               1, NULL, [] { INA226.setMode(INA_CONTINUOUS_BOTH); }},
+  {"setAveraging",          1, NULL, [] { INA226.setAveraging(4); }},
+  {"setBusConversion",      1, NULL, [] { INA226.setBusConversion(4); }},
+  {"setShuntConversion",    1, NULL, [] { INA226.setShuntConversion(4); }},
+  {"setAlertPinOnConversion",1,NULL, [] { INA226.setAlertPinOnConversion(false); }},
+  {"resyncRegisters",       8, NULL, [] { INA226.resyncRegisters();
+                                          check(INA226.getConfiguration()==0x4327,"shadow matches device"); }},
+  {"resyncRegisters, reset", 9, [] { inaSimBus.device(0x40)->reset(); },
+                               [] { INA226.resyncRegisters();
+                                    check(INA226.getConfiguration()==0x4127,"power-on configuration");
+                                    check(inaSimBus.device(0x40)->readRegister(INA_CALIBRATION_REG)==
+                                          inaSimBus.device(0x41)->readRegister(INA_CALIBRATION_REG),"calibration"); }},
+  {"getBusMilliVolts",      2, NULL, [] { check(INA226.getBusMilliVolts()==BENCH_BUS_MILLIVOLTS,"bus mV"); }},
+  {"getShuntMicroVolts",    2, NULL, [] { check(INA226.getShuntMicroVolts()==BENCH_SHUNT_MICROVOLTS,"shunt uV"); }},
+  {"getShuntMicroVolts trig",3, [] { INA226.setMode(INA_TRIGGERED_SHUNT); settle(); },
+                               [] { uint32_t before = INA226.getTransactionCount();
+                                    check(INA226.getShuntMicroVolts()==BENCH_SHUNT_MICROVOLTS,"shunt uV");
+                                    check(INA226.getTransactionCount()==before+3,"shunt-only retrigger"); }},
+  {"getBusMicroAmps",       2, NULL, [] { INA226.getBusMicroAmps(); }},
+  {"getBusMicroWatts",      2, NULL, [] { INA226.getBusMicroWatts(); }},
+  {"four getters",          8, NULL, [] { INA226.getBusMilliVolts(); INA226.getShuntMicroVolts();
+                                          INA226.getBusMicroAmps(); INA226.getBusMicroWatts(); }},
+  {"readAll",               4, NULL, [] { readings[0] = INA226.readAll(); checkReading(readings[0],"readAll"); }},
+  {"readRaw",               4, NULL, [] { inaSAMPLE sample = INA226.readRaw();
+                                          INA226.convertSamples(&sample,&readings[0],1);
+                                          checkReading(readings[0],"readRaw+convertSamples"); }},
+  {"poll (ready)",          2, settle, [] { check(INA226.poll()==INA_POLL_READY,"poll ready"); }},
+  {"waitForConversion",     2, NULL, [] { check(INA226.waitForConversion(),"waitForConversion"); }},
+  {"sequential sweep x4",  32, NULL, [] { for (uint8_t unit=0;unit<BENCH_UNITS;unit++) {
+                                            INA226.setMode(INA_TRIGGERED_BOTH,unit);
+                                            INA226.waitForConversion(unit);
+                                            readings[unit] = INA226.readAll(unit);
+                                          } }},
+  {"triggerAll",            4, triggeredUnits, [] { check(INA226.triggerAll()==BENCH_UNITS,"triggerAll"); }},
+  {"collectAll",           28, [] { triggeredUnits(); INA226.triggerAll(); },
+                               [] { check(INA226.collectAll(readings)==BENCH_UNITS,"collectAll");
+                                          checkReading(readings[3],"collectAll"); }},
+  {"readAlerts",            6, [] { inaSimBus.device(0x40)->alertHandler = alertToMark;
+                                    INA226.setAlertPinOnConversion(true); settle(); },
+                               [] { inaSAMPLE batch[4];
+                                    check(INA226.readAlerts(samples,batch,4)==1,"readAlerts");
+                                    check(batch[0].unit==0 && batch[0].busRaw==BENCH_BUS_MILLIVOLTS*100/125,
+                                          "alert sample"); }},
+  {"setTrip",               2, [] { inaSimBus.device(0x40)->alertHandler = alertToTrip; INA226.setTrips(trips); },
+                               [] { INA226.setTrip(50,INA_TRIP_CURRENT,BENCH_RELAY_PIN); }},
+  {"trip, no I2C",          0, [] { inaSimBus.device(0x40)->alertHandler = alertToTrip;
+                                    INA226.setTrips(trips); INA226.setTrip(50,INA_TRIP_CURRENT,BENCH_RELAY_PIN); },
+                               [] { settle(); check(INA226.isOverloaded(),"tripped");
+                                          check(digitalRead(BENCH_RELAY_PIN)==INA_RELAY_TRIPPED,"relay"); }},
+  {"clearTrip",             4, [] { inaSimBus.device(0x40)->alertHandler = alertToTrip;
+                                    INA226.setTrips(trips);
+                                    INA226.setTrip(50,INA_TRIP_CURRENT,BENCH_RELAY_PIN); settle();
+                                    inaSimBus.device(0x40)->setShuntMicroVolts(1000); settle(); },
+                               [] { check(INA226.clearTrip(),"clearTrip"); }},
+  {"setTrip, no trip state",0, [] { inaSimBus.device(0x40)->alertHandler = alertToTrip;
+                                    digitalWrite(BENCH_RELAY_PIN,INA_RELAY_TRIPPED); },
+                               [] { INA226.setTrip(50,INA_TRIP_CURRENT,BENCH_RELAY_PIN); settle();
+                                    check(!INA226.isOverloaded(),"not overloaded");
+                                    check(digitalRead(BENCH_RELAY_PIN)==INA_RELAY_TRIPPED,"relay untouched"); }},
+  {"setTrip, out of range", 0, [] { INA226.setTrips(trips); digitalWrite(BENCH_RELAY_PIN,INA_RELAY_TRIPPED); },
+                               [] { INA226.setTrip(50,INA_TRIP_CURRENT,BENCH_RELAY_PIN,true,BENCH_UNITS);
+                                    check(digitalRead(BENCH_RELAY_PIN)==INA_RELAY_TRIPPED,"relay untouched"); }},
+  {"trip latency",          6, [] { inaSimBus.device(0x40)->alertHandler = alertToTrip; INA226.setTrips(trips); },
+                               [] { check(INA226.startTripLatency(),"startTripLatency");
+                                    uint8_t status;
+                                    while ((status = INA226.pollTripLatency())==INA_POLL_PENDING) delay(1);
+                                    uint32_t latency = INA226.getTripLatency();
+                                    check(status==INA_POLL_READY && latency>0 &&
+                                          latency<=2*INA226.getConversionMicros(),"latency");
+                                    printf("  trip latency %u us, conversion time %u us\n",
+                                           (unsigned)latency,(unsigned)INA226.getConversionMicros()); }},
+  {"trip latency, no alert",6, [] { INA226.setTrips(trips); },
+                               [] { check(INA226.startTripLatency(),"startTripLatency");
+                                    uint8_t status;
+                                    while ((status = INA226.pollTripLatency())==INA_POLL_PENDING) delay(1);
+                                    check(status==INA_POLL_TIMEOUT && INA226.getTripLatency()==0,"timeout"); }},
+  {"convert = readAll, 819mA", 0, NULL, [] { compareConverters(0); }},
+  {"convert = readAll, 100A", 0, [] { INA226.begin(100000,500,1,0x41); }, [] { compareConverters(1); }},
+  {"readAll x100",        400, [] { INA226.setTelemetry(telemetry); },
+                               [] { for (uint8_t i=0;i<100;i++) INA226.readAll(1);
+                                    printf("  read latency p50 %u us, p99 %u us\n",
+                                           (unsigned)INA226.getLatencyPercentile(INA_LATENCY_READ,50),
+                                           (unsigned)INA226.getLatencyPercentile(INA_LATENCY_READ,99)); }},
+  {"readAll, NACK retried",  5, [] { INA226.setTelemetry(telemetry); inaSimBus.injectFault(INA_SIM_FAULT_NACK); },
+                               [] { checkReading(INA226.readAll(1),"NACK retried");
+                                    check(INA226.getBusHealth(1).nacks==1 && INA226.getBusHealth(1).retries==1,
+                                          "NACK counted"); }},
+  {"readAll, no telemetry",  5, [] { inaSimBus.injectFault(INA_SIM_FAULT_NACK); },
+                               [] { checkReading(INA226.readAll(1),"NACK retried");
+                                    check(INA226.getBusHealth(1).nacks==0 &&
+                                          INA226.getLatencyPercentile(INA_LATENCY_READ,50)==0,"nothing counted"); }},
+  {"readAll, short retried", 6, [] { INA226.setTelemetry(telemetry);
+                                    inaSimBus.injectFault(INA_SIM_FAULT_SHORT_READ); },
+                               [] { checkReading(INA226.readAll(1),"short read retried");
+                                    check(INA226.getBusHealth(1).shortReads==1,"short read counted"); }},
+  {"write, timeout retried", 2, [] { INA226.setTelemetry(telemetry); inaSimBus.injectFault(INA_SIM_FAULT_TIMEOUT); },
+                               [] { INA226.setAveraging(4,1);
+                                    check(INA226.getBusHealth(1).timeouts==1 &&
+                                          INA226.getTransmissionStatus()==0,"timeout counted"); }},
+  {"readAll, unit lost",     6, [] { INA226.setTelemetry(telemetry); inaSimBus.injectFault(INA_SIM_FAULT_NACK,6); },
+                               [] { inaREADING reading = INA226.readAll(1);
+                                    check(reading.busRaw==0 && reading.shuntRaw==0,"failed read is zero");
+                                    check(INA226.getBusHealth(1).failures==2 &&
+                                          INA226.getBusHealth(1).retries==2*INA_I2C_RETRIES,"failures counted");
+                                    check(INA226.getTransmissionStatus()==INA_I2C_NACK_ADDRESS,"status"); }},
+  {"rack: begin on bus 0",  18, setupRack, [] { rack.begin(819,100000,0,0x44,0); rack.begin(819,100000,1,0x45,0);
+                                                check(rack.getAddress(1)==0x45,"begin bus 0"); }},
+  {"rack: scan bus 1",      18, [] { setupRack(); rack.begin(819,100000,0,0x44,0); rack.begin(819,100000,1,0x45,0); },
+                               [] { check(rack.scan(819,100000,1)==2,"scan bus 1");
+                                           check(rack.getBus(3)==1 && rack.getAddress(3)==0x41,"unit 3 on bus 1");
+                                           check(rack.getAddress(1)==0x45,"bus 0 units kept"); }},
+  {"rack: acquire x40",    240, startRack, acquireRack},
+  {"rack: readAll 400kHz",   4, startRack, [] { checkReading(rack.readAll(2),"400kHz"); }},
+  {"rack: readAll HS mode",  6, [] { startRack(); check(rack.setHighSpeed(INA_I2C_HS_CLOCK,1),"HS capable"); },
+                               [] { checkReading(rack.readAll(2),"HS mode");
+                                    check(simBus2.protocolErrors==0,"HS protocol"); }},
+  {"stream: encode+decode", 240, NULL, encodeStream},
+  {"stream: corrupted byte", 0, [] { buildStream(); }, decodeCorrupted},
+  {"tuneFor 1kHz",           1, NULL, [] { uint32_t period = INA226.tuneFor(1000,2); printTuning(period,2);
+                                          check(period<=1000 && period==INA226.getConversionMicros(2),"1kHz"); }},
+  {"tuneFor 2MHz",           1, NULL, [] { uint32_t period = INA226.tuneFor(2000000,2); printTuning(period,2);
+                                          check((INA226.getConfiguration(2)&0x0FF8)==0,"fastest setting"); }},
+  {"tuneFor 100Hz",          0, NULL, [] { uint32_t period = INA226.tuneFor(100,2); printTuning(period,2);
+                                          check(period<=10000 && period>5000,"100Hz"); }},
+  {"tuneFor 10Hz, noisy",    1, [] { inaSimBus.device(0x42)->setShuntNoise(BENCH_NOISE_MICROVOLTS);
+                                    INA226.setAccumulators(accumulators); INA226.setAccumulating(true,2); },
+                               [] { uint32_t period = INA226.tuneFor(10,2); printTuning(period,2);
+                                    check(period<=100000 && period>50000,"10Hz"); }},
+  {"adaptTuning, quieter",   1, noisyTuning,
+                               [] { uint32_t period = INA226.adaptTuning(BENCH_NOISE_TARGET,2);
+                                    printTuning(period,2);
+                                    check(period<10000,"faster within the noise target"); }},
+  {"adaptTuning, in band",   0, [] { noisyTuning(); INA226.adaptTuning(BENCH_NOISE_TARGET,2); sampleNoise(); },
+                               [] { uint32_t before = INA226.getConversionMicros(2);
+                                    inaSTATISTICS statistics; INA226.getStatistics(statistics,false,2);
+                                    float noise = sqrt(statistics.busMicroAmps.variance)/10;// 0.1 Ohm shunt
+                                    printf("  measured shunt noise %.1f uV rms\n",noise);
+                                    check(INA226.adaptTuning(BENCH_NOISE_TARGET,2)==before,"no change in band");
+                                    check(noise<=BENCH_NOISE_TARGET,"noise target met"); }},
+  {"statistics, 10^6 samples", 0, [] { INA226.setAccumulators(accumulators); }, longStatistics},
+  {"statistics, 2^32 samples", 0, [] { INA226.setAccumulators(accumulators); }, boundaryStatistics},
+  {"setSchedule 1s",         1, NULL,
+                               [] { INA226.setSchedule(schedule,BENCH_SCHEDULE_MILLIS,3);
+                                    check(poweredDown(0x43),"powered down"); }},
+  {"runSchedule: sample",    8, [] { INA226.setSchedule(schedule,BENCH_SCHEDULE_MILLIS,3); }, scheduledSample},
+  {"runSchedule: asleep",    0, [] { INA226.setSchedule(schedule,BENCH_SCHEDULE_MILLIS,3); awaitSchedule(); },
+                               [] { uint32_t start = millis();
+                                          while (millis()-start<BENCH_SCHEDULE_MILLIS*9/10) {
+                                            check(INA226.runSchedule(schedule,readings)==0,"nothing due");
+                                            delay(1);
+                                          } }},
+  {"runSchedule: next",      8, [] { INA226.setSchedule(schedule,BENCH_SCHEDULE_MILLIS,3); awaitSchedule(); },
+                               scheduledSample},
+}; // of benchCases
+
+int main(int argc,char *argv[]) {
+  bool    passed = true;                                                       // Every selected call passed
+  uint8_t ran    = 0;                                                          // Calls selected
+  printf("%-26s %6s %6s %6s %9s %10s %6s\n","call","driver","bus","bytes","bus us","elapsed us","budget");
+  for (size_t i=0;i<sizeof(benchCases)/sizeof(benchCases[0]);i++) {
+    const benchCASE &bench = benchCases[i];
+    if (argc>1 && !strstr(bench.name,argv[1])) continue;                       // Not selected
+    sane = true;
+    freshBench();                                                              // Independent of earlier calls
+    if (bench.prepare) bench.prepare();                                        // Not measured
+    INA226.resetBusCounters();
+    rack.resetBusCounters();
+    inaSimBus.resetStats();
+    simBus2.resetStats();
+    uint64_t start = inaSimNow();
+    bench.run();                                                               // Measured
+    uint64_t elapsed = inaSimNow()-start;
+    uint32_t driverTransactions = INA226.getTransactionCount()+rack.getTransactionCount();
+    uint32_t driverBytes        = INA226.getByteCount()+rack.getByteCount();
+    uint32_t busTransactions    = inaSimBus.transactions+simBus2.transactions;
+    uint32_t busBytes           = inaSimBus.bytes+simBus2.bytes;
+    uint64_t busMicros          = inaSimBus.busMicros+simBus2.busMicros;
+    bool ok = sane && driverTransactions<=bench.budget &&                      // Sane, within budget and the
+              driverTransactions==busTransactions && driverBytes==busBytes;    // driver counters agree with bus
+    printf("%-26s %6u %6u %6u %9llu %10llu %6u %s\n",bench.name,(unsigned)driverTransactions,
+           (unsigned)busTransactions,(unsigned)busBytes,(unsigned long long)busMicros,
+           (unsigned long long)elapsed,bench.budget,ok ? "" : "FAIL");
+    passed &= ok;
+    ran++;
+  }
+  printf("inaSTRUCT %u bytes per unit, INA226_Class %u bytes on this host\n",(unsigned)sizeof(inaSTRUCT),
+         (unsigned)sizeof(INA226_Class));                                      // RAM cost of the unit table
+  return(passed && ran ? 0 : 1);                                               // Non-zero fails CI
+} // END of main()
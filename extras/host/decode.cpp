@@ -0,0 +1,51 @@
+/*******************************************************************************************************************
+** Command line decoder for a binary stream captured from INA226_Encoder, e.g. with "cat /dev/ttyACM0 > log.bin". **
+** Reads the file given as argument or standard input and writes one CSV line per sample to standard output:      **
+** micros,unit,address,bus,bus_mV,shunt_uV,current_uA,power_uW. Current and power are left empty for units whose  **
+** header frame has not been received. Frame statistics are written to standard error.                            **
+**                                                                                                                **
+** This program is free software: you can redistribute it and/or modify it under the terms of the GNU General     **
+** Public License as published by the Free Software Foundation, either version 3 of the License, or (at your      **
+** option) any later version. This program is distributed in the hope that it will be useful, but WITHOUT ANY     **
+** WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the   **
+** GNU General Public License for more details. You should have received a copy of the GNU General Public License **
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.                                          **
+*******************************************************************************************************************/
+#include <stdio.h>
+#include "INA226_Decoder.h"                                                    // Stream decoder
+
+static void printSample(const inaSAMPLE &sample,const inaREADING &reading,bool scaled,void *context) {
+  INA226_Decoder &decoder = *(INA226_Decoder*)context;                         // For the unit metadata
+  const inaUNITINFO &unit = decoder.unitInfo(sample.unit);
+  printf("%lu,%u,",(unsigned long)sample.micros,(unsigned)sample.unit);
+  if (unit.valid) printf("0x%02X,%u,",(unsigned)unit.address,(unsigned)unit.bus);
+  else            printf(",,");
+  printf("%lu,%ld,",(unsigned long)reading.busMilliVolts,(long)reading.shuntMicroVolts);
+  if (scaled) printf("%lld,%lld\n",(long long)reading.busMicroAmps,(long long)reading.busMicroWatts);
+  else        printf(",\n");
+} // END of function printSample()
+
+int main(int argc,char *argv[]) {
+  FILE *input = stdin;                                                         // Default to a pipe
+  if (argc>2) {
+    fprintf(stderr,"usage: %s [capture.bin]\n",argv[0]);
+    return(2);
+  }
+  if (argc==2 && !(input = fopen(argv[1],"rb"))) {
+    perror(argv[1]);
+    return(2);
+  }
+  INA226_Decoder decoder;
+  decoder.sampleHandler  = printSample;
+  decoder.handlerContext = &decoder;
+  printf("micros,unit,address,bus,bus_mV,shunt_uV,current_uA,power_uW\n");
+  uint8_t chunk[4096];
+  size_t  length;
+  while ((length = fread(chunk,1,sizeof(chunk),input))>0) decoder.feed(chunk,length);
+  if (input!=stdin) fclose(input);
+  fprintf(stderr,"%lu frames (%lu headers), %lu samples, %lu CRC errors, %lu lost, %lu malformed, "
+          "%lu bytes skipped\n",(unsigned long)decoder.frames,(unsigned long)decoder.headers,
+          (unsigned long)decoder.samples,(unsigned long)decoder.crcErrors,(unsigned long)decoder.lostFrames,
+          (unsigned long)decoder.malformed,(unsigned long)decoder.skippedBytes);
+  return(decoder.crcErrors || decoder.malformed ? 1 : 0);                      // Non-zero if the capture is damaged
+} // END of main()